@@ -94,9 +94,69 @@
 #define INVERT_ENABLE_PIN true
 #define INVERT_ALARM_PIN true
 
+// Direction timing required by the stepper driver, in nanoseconds.  Hold is
+// the time the old direction is kept after the last step pulse; setup is the
+// time the new direction is present before the next step pulse.
+#define STEPPER_DIRECTION_HOLD_NS 2500
+#define STEPPER_DIRECTION_SETUP_NS 5000
+
+// Step timing limits from the stepper driver's datasheet.  Step timing set at
+// runtime is refused if it would break these.
+#define STEPPER_DRIVER_MIN_PULSE_NS 2500
+#define STEPPER_DRIVER_MIN_SPACE_NS 2500
+#define STEPPER_DRIVER_MAX_STEP_RATE_HZ 200000
+
+// Step timing used at startup: pulse width and minimum low time between
+// pulses, in nanoseconds, and the step rate ceiling, in Hertz.  Faster drivers
+// can use shorter pulses to reach higher step rates.
+#define STEPPER_PULSE_NS 5000
+#define STEPPER_SPACE_NS 5000
+#define STEPPER_MAX_STEP_RATE_HZ 100000
+
+// Backlash in the drive train, in steps, taken up with extra steps whenever
+// the motor reverses (0 to disable).  Take-up steps are fed in no faster than
+// STEPPER_BACKLASH_RATE_HZ, on top of the synchronized motion.
+#define STEPPER_BACKLASH_STEPS 0
+#define STEPPER_BACKLASH_RATE_HZ 5000
+
+// Leadscrew pitch error compensation.  PITCH_COMPENSATION_TABLE holds the
+// correction, in 1/256 steps, to add at every 2^PITCH_COMPENSATION_SEGMENT_BITS
+// steps of carriage travel, starting PITCH_COMPENSATION_ORIGIN steps from where
+// the carriage was at power on; corrections in between are interpolated, and
+// the end values hold beyond the table.  Measure against a reference with
+// compensation off, starting from the calibration position.
+//#define USE_PITCH_COMPENSATION
+#define PITCH_COMPENSATION_SEGMENT_BITS 10
+#define PITCH_COMPENSATION_ORIGIN 0
+#define PITCH_COMPENSATION_TABLE { 0, 0 }
+
 // Enable servo alarm feedback
 #define USE_ALARM_PIN
 
+// Acceleration limit for engaging sync while the spindle is turning (power on,
+// feed/thread selection, gear change), in steps per second squared.  The
+// carriage ramps up to spindle speed at this rate, then catches up the phase
+// it lost on the way.
+#define SYNC_ACCELERATION 100000
+
+// Drive a second stepper, e.g. on the cross slide, from the spindle alongside
+// the leadscrew.  It shares the leadscrew's driver settings and pin polarity.
+//#define CROSS_AXIS
+
+#ifdef CROSS_AXIS
+// Cross slide motor and screw, defined like the leadscrew: CROSS_TPI for an
+// imperial screw or CROSS_HMM for a metric one, not both
+#define CROSS_MICROSTEPS 8
+#define CROSS_RESOLUTION 200
+#define CROSS_TPI 10
+//#define CROSS_HMM 200
+
+// Taper turned when taper mode is switched on (SET in feed mode): the angle
+// between the cut and the spindle axis, in minutes of arc.  Negative tapers
+// the other way.
+#define TAPER_ANGLE_ARCMIN 90
+#endif // CROSS_AXIS
+
 //================================================================================
 //                                 ENCODER
 //
@@ -114,6 +174,35 @@
 // Uncomment to reverse encoder direction
 #define REVERSE_ENCODER
 
+// Have DMA copy every value the encoder state machine pushes into a word of
+// RAM, so reading the position is a single load instead of draining the PIO
+// FIFO.  The state machine samples the pins and pushes the count once per
+// pass of its loop, and its clock is divided so that even the longest pass
+// runs ENCODER_MAX_COUNT_RATE times a second; this sets both how often the
+// pins are sampled and, roughly, how many DMA transfers are made.  It must
+// exceed the fastest the count can change (counts per second at top spindle
+// speed).  The ratio engine is also proven at compile time not to overflow
+// at this rate.
+//#define ENCODER_DMA_MIRROR
+#define ENCODER_MAX_COUNT_RATE 1000000
+
+// Timestamp every cycle of encoder channel A in a spare PIO, and measure low
+// spindle speeds from the time between edges instead of the tracking
+// estimator.  Gives a fine, prompt speed at low RPM.
+//#define ENCODER_EDGE_TIMESTAMPS
+
+// Check the count against the encoder's index (Z) pulse on QUADRATURE_Z_PIN.
+// The count is latched on every index edge and must have moved by exactly
+// ENCODER_RESOLUTION; only across a reversal is it allowed
+// ENCODER_INDEX_TOLERANCE, for the width of the pulse.  Anything else counts
+// as an encoder error.  The index also gives an absolute spindle angle.  Requires ENCODER_DMA_MIRROR.
+//#define ENCODER_INDEX
+#define ENCODER_INDEX_TOLERANCE 1
+
+// Most starts offered for multi-start threads.  Only start counts that divide
+// ENCODER_RESOLUTION evenly can be selected, so each start is exact.
+#define MAX_THREAD_STARTS 8
+
 //================================================================================
 //                                FEATURES
 //
@@ -131,11 +220,17 @@
 //================================================================================
 
 // Maximum number of buffered steps
-// The ELS can only output steps at approximately 100KHz.  If you ask the ELS to
-// output steps faster than this, it will get behind and will stop automatically
+// The ELS can only output steps at STEPPER_MAX_STEP_RATE_HZ, or less if the
+// pulse timing does not allow it.  If you ask the ELS to output steps faster
+// than this, it will get behind and will stop automatically
 // when the buffered step count exceeds this value.
 #define MAX_BUFFERED_STEPS 100
 
+// Warn when the step rate needed at the current speed comes within this many
+// percent of the stepper's limit.  Feed changes the stepper could not keep up
+// with at the current speed are refused outright.
+#define OVERSPEED_WARNING_HEADROOM 10
+
 //================================================================================
 //                               CPU / TIMING
 //
@@ -147,6 +242,34 @@
 // Two cycles are required per step
 #define STEPPER_CYCLE_US 5
 
+// Delay from sampling the spindle encoder to the resulting step pulse leaving
+// the stepper state machine, in microseconds.  The motion core projects the
+// spindle position forward by this much at the current spindle speed, so the
+// thread start does not shift with RPM.  To measure, scope encoder channel A
+// against the step output at a steady speed.
+#define MOTION_LATENCY_US 8
+
+// Memory of the spindle velocity and acceleration estimator, as a power of two
+// in motion loop passes.  Larger is smoother but slower to follow speed
+// changes; 10 is about 5ms at STEPPER_CYCLE_US of 5us.
+#define SPINDLE_ESTIMATOR_SHIFT 10
+
+// Spindle reversals of up to this many encoder counts are ignored, so a stopped
+// spindle rocking by a count or two does not make the motor buzz back and
+// forth.  Motion in one direction is followed exactly, and a real reversal is
+// followed from the moment it exceeds the deadband.  0 disables.
+#define MOTION_DEADBAND_COUNTS 2
+
+// Run the motion loop each time the spindle encoder moves MOTION_TRIGGER_COUNTS
+// counts, instead of every STEPPER_CYCLE_US.  Core 1 then works in proportion to
+// spindle speed and reacts to encoder edges without waiting for the next tick.
+// The loop still runs every MOTION_FALLBACK_US so ramps and queued steps carry
+// on while the spindle is slow or stopped.  MOTION_TRIGGER_COUNTS must be a
+// multiple of 4 (one full cycle of channel A).
+//#define MOTION_EVENT_DRIVEN
+#define MOTION_TRIGGER_COUNTS 4
+#define MOTION_FALLBACK_US 250
+
 // User interface refresh rate, in Hertz
 #define UI_REFRESH_RATE_HZ 100
 
@@ -159,6 +282,10 @@
 
 #define GEARBOX_I2C_BAUDRATE 100000
 
+// Uncomment to print a cycle-count comparison of the integer ratio engine
+// against the legacy floating-point feed calculation at startup
+//#define BENCHMARK_FEED_RATIO
+
 //================================================================================
 //                               GPIO PIN ASSIGNMENTS
 //
@@ -170,9 +297,16 @@
 #define STEPPER_ENABLE_PIN      8
 #define STEPPER_ALARM_PIN       9
 
+// Second (cross slide) motor driver I/O, used with CROSS_AXIS
+#define CROSS_STEP_PIN          10
+#define CROSS_DIRECTION_PIN     11
+#define CROSS_ENABLE_PIN        12
+#define CROSS_ALARM_PIN         13
+
 // Spindle encoder inputs
 #define QUADRATURE_A_PIN 28
 #define QUADRATURE_B_PIN 27
+#define QUADRATURE_Z_PIN 26
 
 // Control panel I/O
 #define CONTROL_PANEL_STB_PIN 16
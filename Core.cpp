@@ -28,69 +28,381 @@
 // SOFTWARE.
 
 #include "Core.h"
+#include <cmath>
+
+#ifdef USE_PITCH_COMPENSATION
+static const int16_t PITCH_CORRECTIONS[] = PITCH_COMPENSATION_TABLE;
+static const PitchCompensation leadscrewCompensation(PITCH_CORRECTIONS,
+    sizeof(PITCH_CORRECTIONS) / sizeof(PITCH_CORRECTIONS[0]),
+    PITCH_COMPENSATION_SEGMENT_BITS, PITCH_COMPENSATION_ORIGIN);
+
+static_assert(sizeof(PITCH_CORRECTIONS) / sizeof(PITCH_CORRECTIONS[0]) >= 2,
+    "PITCH_COMPENSATION_TABLE needs at least two points");
+#endif
 
 Core :: Core( Encoder *encoder, StepperDrive *stepperDrive )
 {
     this->encoder = encoder;
-    this->stepperDrive = stepperDrive;
 
-    feed = NULL_FEED;
+    powerOn = false;
+    axisCount = 0;
+
+    feedNumerator = 0;
+    feedDenominator = 1;
     feedDirection = 0;
 
-    driveRatio = 1.0;
+#ifdef CROSS_AXIS
+    taperNumerator = 0;
+    taperDenominator = 1;
+    taperDirection = 1;
+#endif
+
+    driveNumerator = 1;
+    driveDenominator = 1;
+
+    deadbandPosition = 0;
+    deadbandForward = true;
+
+    startOffset = 0;
+    startChanged = false;
+
+    armChanged = false;
+    armed = false;
+    startAngleValid = false;
+    startAngle = 0;
+    previousInput = 0;
 
-    previousSpindlePosition = 0;
-    previousFeedDirection = 0;
-    previousFeed = NULL_FEED;
+    // addAxis gears each axis to the current feed, so that comes first
+    addAxis(stepperDrive);
+#ifdef USE_PITCH_COMPENSATION
+    axes[LEADSCREW_AXIS].setCompensation(&leadscrewCompensation);
+#endif
 
     setPowerOn(true); // default to power on
 }
 
 Core :: Core(void) {
-    
+    axisCount = 0;
+#ifdef CROSS_AXIS
+    taperNumerator = 0;
+    taperDenominator = 1;
+    taperDirection = 1;
+#endif
+}
+
+//
+// Drive another axis from the spindle, at a ratio of its own set with
+// setAxisRatio.  Call before the motion loop starts.  Returns the axis
+// number, or -1 if there are no axes left.
+//
+int Core :: addAxis(StepperDrive *stepperDrive)
+{
+    if( axisCount >= MAX_AXES ) {
+        return -1;
+    }
+    axes[axisCount].attach(stepperDrive);
+    stepperDrive->setEnabled(powerOn);
+    axisCount++;
+
+    // gear the new axis to the current feed at once, not on the next change
+    updateRatio();
+    return axisCount - 1;
+}
+
+//
+// Steps of an axis per encoder count, as an exact fraction
+//
+void Core :: setAxisRatio(uint8_t axis, uint64_t numerator, uint64_t denominator, int32_t direction)
+{
+    if( axis < axisCount ) {
+        // all of the division happens here, off the hot path
+        RATIO ratio = RatioEngine::makeRatio(numerator, denominator, direction);
+        axes[axis].setRatio(&ratio);
+    }
+}
+
+//
+// Step rate a feed needs at a spindle speed with the current drive ratio,
+// in steps per second, on whichever axis has to step fastest.  Every axis
+// runs the same step timing, so they share one ceiling.
+//
+uint64_t Core :: requiredStepRate(uint64_t feedNumerator, uint64_t feedDenominator, uint16_t rpm)
+{
+    uint64_t countsPerMinute = (uint64_t)rpm * ENCODER_RESOLUTION;
+    uint64_t required = countsPerMinute * feedNumerator * driveNumerator / (60 * feedDenominator * driveDenominator);
+#ifdef CROSS_AXIS
+    // the cross slide is geared to the leadscrew while turning a taper
+    if( taperNumerator != 0 ) {
+        required = std::max(required, (uint64_t)((double)required * taperNumerator / taperDenominator));
+    }
+#endif
+    return required;
+}
+
+//
+// Share of the step rate ceiling left over at the current speed and feed, in
+// percent
+//
+uint8_t Core :: getHeadroom(void)
+{
+    uint64_t required = requiredStepRate(feedNumerator, feedDenominator, getRPM());
+    uint32_t ceiling = getMaxStepRate();
+    if( required >= ceiling ) {
+        return 0;
+    }
+    return (uint8_t)((ceiling - required) * 100 / ceiling);
+}
+
+//
+// Change the step pulse width, spacing and rate ceiling of every axis; each
+// drive takes it up the next time it is idle.  Returns false, changing
+// nothing, if the drives cannot generate it.
+//
+bool Core :: setStepTiming(uint32_t pulseNs, uint32_t spaceNs, uint32_t maxStepRateHz)
+{
+    STEPPER_TIMING timing;
+    if( !StepperDrive::planTiming(pulseNs, spaceNs, maxStepRateHz, &timing) ) {
+        return false;
+    }
+    for( uint8_t i = 0; i < axisCount; i++ ) {
+        axes[i].getDrive()->configureTiming(pulseNs, spaceNs, maxStepRateHz);
+    }
+    return true;
 }
 
 void Core :: setReverse(bool reverse)
 {
     feedDirection = reverse ? -1 : 1;
+    updateRatio();
+}
+
+#ifdef CROSS_AXIS
+//
+// Multiply numerator/denominator by n/d, cancelling common factors first.
+// A product still too large for 64 bits gives up the low bits of n and d.
+// A zero denominator, or a ratio beyond 64 bits, is a bug in the caller.
+//
+static void multiplyFraction(uint64_t *numerator, uint64_t *denominator, uint64_t n, uint64_t d)
+{
+    if( d == 0 ) {
+        panic("multiplyFraction: zero denominator");
+    }
+
+    uint64_t a = fraction_gcd(*numerator, d);
+    uint64_t b = fraction_gcd(n, *denominator);
+    if( a > 1 ) { *numerator /= a; d /= a; }
+    if( b > 1 ) { n /= b; *denominator /= b; }
+
+    while( (n > 1 && *numerator > UINT64_MAX / n) || (d > 1 && *denominator > UINT64_MAX / d) ) {
+        if( d == 1 ) {
+            panic("multiplyFraction: ratio out of range");
+        }
+        n >>= 1;
+        d >>= 1;
+    }
+    *numerator *= n;
+    *denominator *= d;
+}
+
+//
+// Cross slide steps per leadscrew step for a taper of this angle; zero
+// switches taper mode off.  Returns false, changing nothing, for an angle
+// outside the +/-45 degrees SanityCheck.h allows.
+//
+bool Core :: computeTaper(int32_t arcminutes)
+{
+    if( arcminutes <= -MAX_TAPER_ARCMIN || arcminutes >= MAX_TAPER_ARCMIN ) {
+        return false;
+    }
+
+    uint32_t tanNumerator = 0, tanDenominator = 1;
+    if( arcminutes != 0 ) {
+        float angle = (float)std::abs(arcminutes) * (3.14159265f / (180.0f * 60.0f));
+        RatioEngine::fromFloat(tanf(angle), &tanNumerator, &tanDenominator);
+    }
+
+    taperNumerator = (uint64_t)tanNumerator * CROSS_STEPS_PER_INCH_NUMERATOR;
+    taperDenominator = (uint64_t)tanDenominator * CROSS_STEPS_PER_INCH_DENOMINATOR;
+    multiplyFraction(&taperNumerator, &taperDenominator,
+                     FEED_STEPS_PER_INCH_DENOMINATOR, FEED_STEPS_PER_INCH_NUMERATOR);
+    taperDirection = arcminutes < 0 ? -1 : 1;
+    return true;
+}
+
+//
+// Turn a taper of this angle from the spindle axis, by driving the cross
+// slide in proportion to the carriage; zero switches taper mode off
+//
+void Core :: setTaper(int32_t arcminutes)
+{
+    if( computeTaper(arcminutes) ) {
+        updateRatio();
+    }
+}
+#endif
+
+void Core :: updateRatio(void)
+{
+    setAxisRatio(LEADSCREW_AXIS, feedNumerator * driveNumerator,
+                 feedDenominator * driveDenominator, feedDirection);
+
+#ifdef CROSS_AXIS
+    // the cross slide is geared to the spindle through the leadscrew's
+    // ratio, so both axes come from the same count and stay in lockstep
+    uint64_t numerator = feedNumerator * driveNumerator;
+    uint64_t denominator = feedDenominator * driveDenominator;
+    multiplyFraction(&numerator, &denominator, taperNumerator, taperDenominator);
+    setAxisRatio(CROSS_SLIDE_AXIS, numerator, denominator, feedDirection * taperDirection);
+#endif
 }
 
 void Core :: setPowerOn(bool powerOn)
 {
     this->powerOn = powerOn;
-    stepperDrive->setEnabled(powerOn);
+    for( uint8_t i = 0; i < axisCount; i++ ) {
+        axes[i].getDrive()->setEnabled(powerOn);
+    }
+
+    // the motor was idle while disabled; bring it up to speed gradually
+    if( powerOn ) {
+        engageFromRest = true;
+    }
 }
 
-void Core :: ISR( void )
+static inline int32_t spindleAngle(int64_t position)
 {
-    if( this->feed != NULL_FEED && !stepperDrive->busy()) {
-        // read the encoder
-        int32_t spindlePosition = encoder->getPosition();
+    int32_t angle = (int32_t)(position % ENCODER_RESOLUTION);
+    return angle < 0 ? angle + ENCODER_RESOLUTION : angle;
+}
 
-        // calculate the desired stepper position
-        int32_t desiredSteps = feedRatio(spindlePosition);
-        stepperDrive->setDesiredPosition(desiredSteps);
+//
+// Find the first count after from, up to and including to, that lands on the
+// start angle, in whichever direction the spindle turned
+//
+bool Core :: findStartAngle(int64_t from, int64_t to, int64_t *crossing)
+{
+    if( to > from ) {
+        *crossing = from + 1 + spindleAngle(startAngle - (from + 1));
+        return *crossing <= to;
+    }
+    if( to < from ) {
+        *crossing = from - 1 - spindleAngle((from - 1) - startAngle);
+        return *crossing >= to;
+    }
+    return false;
+}
 
-        // compensate for encoder overflow/underflow
-        if( spindlePosition < previousSpindlePosition && previousSpindlePosition - spindlePosition > encoder->getMaxCount()/2 ) {
-            stepperDrive->incrementCurrentPosition(-1 * feedRatio(encoder->getMaxCount()));
+//
+// Armed start bookkeeping; true while the axes should keep holding.
+// Anchoring the engines on the crossing count itself, not the sampled one,
+// makes each engagement land on the same count however far the spindle
+// moved during the tick.
+//
+bool Core :: armedUpdate(int64_t input)
+{
+    if( armChanged ) {
+        if( pendingArmed ) {
+            // a carriage still moving brakes and comes back to where it was
+            armed = true;
+            for( uint8_t i = 0; i < axisCount; i++ ) {
+                axes[i].hold();
+            }
+        } else {
+            startAngleValid = false;
+            if( armed ) {
+                armed = false;
+                for( uint8_t i = 0; i < axisCount; i++ ) {
+                    axes[i].release(input);
+                }
+            }
         }
-        if( spindlePosition > previousSpindlePosition && spindlePosition - previousSpindlePosition > encoder->getMaxCount()/2 ) {
-            stepperDrive->incrementCurrentPosition(feedRatio(encoder->getMaxCount()));
+        armChanged = false;
+    }
+
+    if( armed ) {
+        int64_t crossing = input;
+        if( !startAngleValid ) {
+            startAngle = spindleAngle(input);
+            startAngleValid = true;
+        } else if( !findStartAngle(previousInput, input, &crossing) ) {
+            return true;
+        }
+
+        armed = false;
+        for( uint8_t i = 0; i < axisCount; i++ ) {
+            axes[i].release(crossing);
         }
+    }
+
+    return false;
+}
+
+//
+// Follow the position exactly while it keeps going the same way; hold on a
+// turn back until it has come back further than the deadband, then follow
+// again.  The output is never more than the deadband away from the input,
+// so no counts are lost.
+//
+int64_t Core :: applyDeadband(int64_t position)
+{
+    int64_t back = deadbandForward ? deadbandPosition - position : position - deadbandPosition;
+    if( back <= 0 ) {
+        deadbandPosition = position;
+    } else if( back > MOTION_DEADBAND_COUNTS ) {
+        deadbandPosition = position;
+        deadbandForward = !deadbandForward;
+    }
+    return deadbandPosition;
+}
+
+//
+// One pass of the motion loop.  ticks is the number of STEPPER_CYCLE_US motion
+// ticks since the previous pass: always one when run from the periodic timer,
+// more when run from encoder events.  Every axis works from the one encoder
+// sample, so they stay in step with each other.
+//
+void Core :: ISR( uint32_t ticks )
+{
+    // read the encoder
+    int64_t spindlePosition = encoder->sample();
 
-        // if the feed, direction, or gear ratio changed, reset sync to avoid a big step
-        if( feed != previousFeed || feedDirection != previousFeedDirection || driveRatio != previousDriveRatio) {
-            stepperDrive->setCurrentPosition(desiredSteps);
+    // track spindle velocity and acceleration
+    spindleEstimator.update(spindlePosition, ticks);
+    encoder->publish(spindleEstimator.getCountsPerSecond(), spindleEstimator.getCountsPerSecondSquared());
+
+    // moving to another start re-anchors the engine a whole number of counts
+    // around the spindle; the carriage ramps over to the new start
+    if( startChanged ) {
+        startOffset = pendingStartOffset;
+        startChanged = false;
+        for( uint8_t i = 0; i < axisCount; i++ ) {
+            axes[i].engage(false);
         }
+    }
+
+    // calculate the desired stepper position where the spindle will be
+    // by the time the steps come out, so the lag does not grow with RPM
+    int32_t lead = (int32_t)((spindleEstimator.getVelocity() * MOTION_LATENCY_TICKS) >> (ESTIMATOR_SHIFT + 8));
+    int64_t leading = spindlePosition + lead;
 
-        // remember values for next time
-        previousSpindlePosition = spindlePosition;
-        previousFeedDirection = feedDirection;
-        previousFeed = feed;
-        previousDriveRatio = driveRatio;
+    // the lead rocks by a count with estimator noise even on a still
+    // spindle, so the deadband goes after it; the start offset goes after
+    // the deadband, so moving to another start is never taken for a reversal
+#if MOTION_DEADBAND_COUNTS > 0
+    leading = applyDeadband(leading);
+#endif
+    int64_t input = leading + startOffset;
+    bool holding = (armed || armChanged) && armedUpdate(input);
+    previousInput = input;
+
+    if( engageFromRest ) {
+        for( uint8_t i = 0; i < axisCount; i++ ) {
+            axes[i].engage(true);
+        }
+        engageFromRest = false;
+    }
 
-        // service the stepper drive state machine
-        stepperDrive->move();
+    for( uint8_t i = 0; i < axisCount; i++ ) {
+        axes[i].update(input, holding, ticks);
     }
 }
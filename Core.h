@@ -36,70 +36,280 @@
 #include "Encoder.h"
 #include "ControlPanel.h"
 #include "Tables.h"
+#include "RatioEngine.h"
+#include "MotionAxis.h"
+#include "SpindleEstimator.h"
 
-#define NULL_FEED 0.0
+// MOTION_LATENCY_US in motion ticks, with 8 fractional bits
+#define MOTION_LATENCY_TICKS ((MOTION_LATENCY_US * 256) / STEPPER_CYCLE_US)
+
+// Most stepper axes driven from the spindle; pio0 has four state machines
+// and the status LED takes one
+#define MAX_AXES 3
+
+// The leadscrew is always the first axis, and the cross slide the second
+#define LEADSCREW_AXIS 0
+#define CROSS_SLIDE_AXIS 1
+
+// Steepest taper, in arcminutes either way
+#define MAX_TAPER_ARCMIN 2700
+
+#ifdef CROSS_AXIS
+// Steps per inch of cross slide travel, and of carriage travel through the
+// feed drive train, as fractions
+#if defined(CROSS_TPI)
+#define CROSS_STEPS_PER_INCH_NUMERATOR ((uint64_t)CROSS_TPI*CROSS_RESOLUTION*CROSS_MICROSTEPS)
+#define CROSS_STEPS_PER_INCH_DENOMINATOR 1
+#endif
+#if defined(CROSS_HMM)
+#define CROSS_STEPS_PER_INCH_NUMERATOR ((uint64_t)2540*CROSS_RESOLUTION*CROSS_MICROSTEPS)
+#define CROSS_STEPS_PER_INCH_DENOMINATOR CROSS_HMM
+#endif
+#if defined(LEADSCREW_TPI)
+#define FEED_STEPS_PER_INCH_NUMERATOR ((uint64_t)LEADSCREW_TPI*STEPPER_RESOLUTION_FEED*STEPPER_MICROSTEPS_FEED)
+#define FEED_STEPS_PER_INCH_DENOMINATOR 1
+#endif
+#if defined(LEADSCREW_HMM)
+#define FEED_STEPS_PER_INCH_NUMERATOR ((uint64_t)2540*STEPPER_RESOLUTION_FEED*STEPPER_MICROSTEPS_FEED)
+#define FEED_STEPS_PER_INCH_DENOMINATOR LEADSCREW_HMM
+#endif
+#endif // CROSS_AXIS
 
 class Core
 {
 private:
     Encoder *encoder;
-    StepperDrive *stepperDrive;
 
-    float feed;
-    float previousFeed;
+    //
+    // Every axis is updated from the same encoder sample on each tick
+    //
+    MotionAxis axes[MAX_AXES];
+    uint8_t axisCount;
 
-    float driveRatio;
-    float previousDriveRatio;
+    uint64_t feedNumerator;
+    uint64_t feedDenominator;
 
     int16_t feedDirection;
-    int16_t previousFeedDirection;
 
-    int32_t previousSpindlePosition;
+    //
+    // Spindle velocity and acceleration, tracked on every tick; the velocity
+    // also projects the position forward over the sample-to-step latency
+    //
+    SpindleEstimator spindleEstimator;
+
+    //
+    // Spindle position after the reversal deadband, and the direction it
+    // last moved in
+    //
+    int64_t deadbandPosition;
+    bool deadbandForward;
+
+    int64_t applyDeadband(int64_t position);
+
+    //
+    // The drives were just enabled; bring every axis up from rest
+    //
+    volatile bool engageFromRest;
+
+    //
+    // Multi-start threads: the spindle position fed to the ratio engine is
+    // advanced by a whole fraction of a turn per start
+    //
+    int32_t startOffset;
+    int32_t pendingStartOffset;
+    volatile bool startChanged;
+
+    //
+    // Armed start: the axes hold until the spindle comes round to the
+    // recorded angle, then their engines are re-anchored on exactly that count
+    //
+    bool pendingArmed;
+    volatile bool armChanged;
+    bool armed;
+    bool startAngleValid;
+    int32_t startAngle;
+    int64_t previousInput;
+
+    bool findStartAngle(int64_t from, int64_t to, int64_t *crossing);
+    bool armedUpdate(int64_t input);
 
     bool powerOn;
 
-    int32_t feedRatio(int32_t count);
+    void updateRatio(void);
 
 protected:
+    //
+    // Drive ratio as an exact fraction; the proxy keeps its own copy so it
+    // can predict step rates without asking the other core
+    //
+    uint32_t driveNumerator;
+    uint32_t driveDenominator;
+
+#ifdef CROSS_AXIS
+    //
+    // Cross slide steps per leadscrew step while turning a taper; zero when
+    // taper mode is off.  The proxy keeps its own copy too.
+    //
+    uint64_t taperNumerator;
+    uint64_t taperDenominator;
+    int16_t taperDirection;
+
+    bool computeTaper(int32_t arcminutes);
+#endif
+
+    uint64_t requiredStepRate(uint64_t feedNumerator, uint64_t feedDenominator, uint16_t rpm);
+
     Core(void);    
 
 public:
     Core( Encoder *encoder, StepperDrive *stepperDrive );    
 
+    int addAxis(StepperDrive *stepperDrive);
+    void setAxisRatio(uint8_t axis, uint64_t numerator, uint64_t denominator, int32_t direction);
+
     virtual void setFeed(const FEED_THREAD*);
     virtual void setReverse(bool reverse);
     virtual void setPowerOn(bool);
     virtual void setDriveRatio(float driveRatio);
+    virtual void setSoftLimits(bool enabled, int32_t lower, int32_t upper);
+    virtual void setThreadStart(uint16_t starts, uint16_t start);
+    virtual void armStart(bool armed);
+#ifdef CROSS_AXIS
+    virtual void setTaper(int32_t arcminutes);
+#endif
+    virtual bool setStepTiming(uint32_t pulseNs, uint32_t spaceNs, uint32_t maxStepRateHz);
+
+    static bool isValidStarts(uint16_t starts);
 
     virtual uint16_t getRPM(void);
+    virtual int32_t getVelocity(void);
+    virtual int32_t getAcceleration(void);
+    virtual int32_t getSpindleAngle(void);
+    virtual uint32_t getEncoderErrors(void);
     virtual bool getIsAlarm(void);
     virtual bool getIsPowerOn(void);
     virtual bool getIsPanic(void);
+    virtual uint8_t getHeadroom(void);
+    virtual uint32_t getMaxStepRate(void);
+
+    bool canSustain(const FEED_THREAD *feed, uint16_t rpm);
 
-    void ISR( void );
+    void ISR( uint32_t ticks );
 };
 
 inline void Core :: setFeed(const FEED_THREAD *feed)
 {
-    this->feed = (float)feed->numerator / (float) feed->denominator;
+    this->feedNumerator = feed->numerator;
+    this->feedDenominator = feed->denominator;
+    updateRatio();
 }
 
 inline void Core :: setDriveRatio(float driveRatio)
 {
-    this->driveRatio = driveRatio;
+    RatioEngine::fromFloat(driveRatio, &this->driveNumerator, &this->driveDenominator);
+    updateRatio();
+}
+
+//
+// Stop the carriage at lower/upper, in steps of the stepper's commanded
+// position.  The check and the braking happen in the ISR.
+//
+inline void Core :: setSoftLimits(bool enabled, int32_t lower, int32_t upper)
+{
+    axes[LEADSCREW_AXIS].setSoftLimits(enabled, lower, upper);
+}
+
+//
+// A start count is usable only if it divides a spindle turn into a whole
+// number of encoder counts, so every start is exact
+//
+inline bool Core :: isValidStarts(uint16_t starts)
+{
+    return starts >= 1 && starts <= MAX_THREAD_STARTS && ENCODER_RESOLUTION % starts == 0;
+}
+
+//
+// Select start (0 to starts - 1) of a multi-start thread
+//
+inline void Core :: setThreadStart(uint16_t starts, uint16_t start)
+{
+    if( isValidStarts(starts) && start < starts ) {
+        this->pendingStartOffset = (int32_t)(ENCODER_RESOLUTION / starts) * start;
+        this->startChanged = true;
+    }
 }
 
-inline int32_t Core :: feedRatio(int32_t count)
+//
+// Arm: hold the carriage and engage when the spindle reaches the recorded
+// start angle, recording it now if there is none.  Disarm: forget the angle
+// and engage at once if still waiting.
+//
+inline void Core :: armStart(bool armed)
 {
-    return (int32_t)((double)count * this->feed * this->driveRatio) * feedDirection;
+    this->pendingArmed = armed;
+    this->armChanged = true;
 }
 
+//
+// Filtered spindle speed, from the tracking estimator, or at low speed from
+// the encoder edge period when that is available
+//
 inline uint16_t Core :: getRPM(void) {
-    return encoder->getRPM();
+    ENCODER_SNAPSHOT snapshot;
+    encoder->getSnapshot(&snapshot);
+    uint64_t countsPerSecond = (uint64_t)std::abs((int64_t)snapshot.velocity);
+#ifdef ENCODER_EDGE_TIMESTAMPS
+    if( countsPerSecond < (uint64_t)ENCODER_EDGE_RATE_MAX_RPM * ENCODER_RESOLUTION / 60 ) {
+        countsPerSecond = encoder->getEdgeRate(&snapshot);
+    }
+#endif
+    return (uint16_t)std::min(countsPerSecond * 60 / ENCODER_RESOLUTION, (uint64_t)UINT16_MAX);
+}
+
+//
+// Signed spindle velocity, in encoder counts per second
+//
+inline int32_t Core :: getVelocity(void) {
+    ENCODER_SNAPSHOT snapshot;
+    encoder->getSnapshot(&snapshot);
+    return snapshot.velocity;
+}
+
+//
+// Signed spindle acceleration, in encoder counts per second squared
+//
+inline int32_t Core :: getAcceleration(void) {
+    ENCODER_SNAPSHOT snapshot;
+    encoder->getSnapshot(&snapshot);
+    return snapshot.acceleration;
+}
+
+//
+// Spindle angle past the encoder index, in counts, or -1 until the index has
+// been seen (always, without ENCODER_INDEX)
+//
+inline int32_t Core :: getSpindleAngle(void) {
+    ENCODER_SNAPSHOT snapshot;
+    encoder->getSnapshot(&snapshot);
+    return Encoder::getAngle(&snapshot);
+}
+
+//
+// Revolutions between index pulses that were not ENCODER_RESOLUTION counts
+//
+inline uint32_t Core :: getEncoderErrors(void) {
+    ENCODER_SNAPSHOT snapshot;
+    encoder->getSnapshot(&snapshot);
+    return snapshot.indexErrors;
 }
 
 inline bool Core :: getIsAlarm(void) {
-    return stepperDrive->isAlarm();
+    for( uint8_t i = 0; i < axisCount; i++ ) {
+        if( axes[i].getDrive()->isAlarm() ) {
+            return true;
+        }
+    }
+    return false;
 }
 
 inline bool Core :: getIsPowerOn(void) {
@@ -107,7 +317,23 @@ inline bool Core :: getIsPowerOn(void) {
 }
 
 inline bool Core :: getIsPanic(void) {
-    return stepperDrive->checkStepBacklog();
+    for( uint8_t i = 0; i < axisCount; i++ ) {
+        if( axes[i].getDrive()->checkStepBacklog() ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint32_t Core :: getMaxStepRate(void) {
+    return axes[LEADSCREW_AXIS].getDrive()->getMaxStepRate();
+}
+
+//
+// Would the stepper keep up with this feed at this spindle speed?
+//
+inline bool Core :: canSustain(const FEED_THREAD *feed, uint16_t rpm) {
+    return requiredStepRate(feed->numerator, feed->denominator, rpm) <= getMaxStepRate();
 }
 
 #endif // __CORE_H
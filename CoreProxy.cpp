@@ -29,4 +29,12 @@ CoreProxy :: CoreProxy ( CrossCoreMessaging* xCore ) {
     this->xCore = xCore;
     isAlarm = false;
     isPanic = false;
+    headroom = 100;
+    velocity = 0;
+    acceleration = 0;
+    spindleAngle = -1;
+    encoderErrors = 0;
+    maxStepRate = STEPPER_MAX_STEP_RATE_HZ;
+    driveNumerator = 1;
+    driveDenominator = 1;
 }
@@ -39,6 +39,12 @@ private:
     bool isAlarm;
     bool powerOn;
     bool isPanic;
+    uint8_t headroom;
+    uint32_t maxStepRate;
+    int32_t velocity;
+    int32_t acceleration;
+    int32_t spindleAngle;
+    uint32_t encoderErrors;
     CrossCoreMessaging* xCore;
 
 public:
@@ -48,11 +54,24 @@ public:
     void setReverse(bool) override;
     void setPowerOn(bool) override;
     void setDriveRatio(float) override;
+    void setSoftLimits(bool, int32_t, int32_t) override;
+    void setThreadStart(uint16_t, uint16_t) override;
+    void armStart(bool) override;
+#ifdef CROSS_AXIS
+    void setTaper(int32_t) override;
+#endif
+    bool setStepTiming(uint32_t, uint32_t, uint32_t) override;
 
     uint16_t getRPM(void) override;
+    int32_t getVelocity(void) override;
+    int32_t getAcceleration(void) override;
+    int32_t getSpindleAngle(void) override;
+    uint32_t getEncoderErrors(void) override;
     bool getIsAlarm() override;
     bool getIsPowerOn() override;
     bool getIsPanic() override;
+    uint8_t getHeadroom() override;
+    uint32_t getMaxStepRate() override;
     
     void checkStatus(void);
 };
@@ -61,6 +80,25 @@ inline uint16_t CoreProxy :: getRPM(void) {
     return rpm;
 }
 
+inline int32_t CoreProxy :: getVelocity(void) {
+    return velocity;
+}
+
+inline int32_t CoreProxy :: getAcceleration(void) {
+    return acceleration;
+}
+
+//
+// As of the last status from the motion core
+//
+inline int32_t CoreProxy :: getSpindleAngle(void) {
+    return spindleAngle;
+}
+
+inline uint32_t CoreProxy :: getEncoderErrors(void) {
+    return encoderErrors;
+}
+
 inline bool CoreProxy :: getIsAlarm(void) {
     return isAlarm;
 }
@@ -73,8 +111,17 @@ inline bool CoreProxy :: getIsPanic(void) {
     return isPanic;
 }
 
+inline uint8_t CoreProxy :: getHeadroom(void) {
+    return headroom;
+}
+
+inline uint32_t CoreProxy :: getMaxStepRate(void) {
+    return maxStepRate;
+}
+
 inline void CoreProxy :: checkStatus(void) {
-    xCore->checkCoreStatus(&rpm, &isAlarm, &powerOn, &isPanic);
+    xCore->checkCoreStatus(&rpm, &isAlarm, &powerOn, &isPanic, &headroom, &maxStepRate, &velocity, &acceleration,
+                           &spindleAngle, &encoderErrors);
 }
 
 inline void CoreProxy :: setFeed(const FEED_THREAD* feed) {
@@ -90,7 +137,43 @@ inline void CoreProxy :: setPowerOn(bool state) {
 }
 
 inline void CoreProxy :: setDriveRatio(float driveRatio) {
+    // same reduction as the core, so predictions here match its step rate
+    RatioEngine::fromFloat(driveRatio, &driveNumerator, &driveDenominator);
     xCore->pushDriveRatioCommand(driveRatio);
 }
 
+inline void CoreProxy :: setSoftLimits(bool enabled, int32_t lower, int32_t upper) {
+    xCore->pushSoftLimitsCommand(enabled, lower, upper);
+}
+
+inline void CoreProxy :: setThreadStart(uint16_t starts, uint16_t start) {
+    xCore->pushThreadStartCommand(starts, start);
+}
+
+inline void CoreProxy :: armStart(bool armed) {
+    xCore->pushArmStartCommand(armed);
+}
+
+#ifdef CROSS_AXIS
+//
+// Checked here as well, so the caller learns at once whether the motion core
+// will take it; the new ceiling comes back with the status
+//
+inline bool CoreProxy :: setStepTiming(uint32_t pulseNs, uint32_t spaceNs, uint32_t maxStepRateHz) {
+    STEPPER_TIMING timing;
+    if( !StepperDrive::planTiming(pulseNs, spaceNs, maxStepRateHz, &timing) ) {
+        return false;
+    }
+    xCore->pushStepTimingCommand(pulseNs, spaceNs, maxStepRateHz);
+    return true;
+}
+
+inline void CoreProxy :: setTaper(int32_t arcminutes) {
+    // same ratio as the core, so step rate predictions include the cross slide
+    if( computeTaper(arcminutes) ) {
+        xCore->pushTaperCommand(arcminutes);
+    }
+}
+#endif
+
 #endif
\ No newline at end of file
@@ -32,11 +32,16 @@ CrossCoreMessaging :: CrossCoreMessaging( void ) {
     queue_init(&reverse_queue, sizeof(bool), 4);
     queue_init(&corestatus_queue, sizeof(corestatus_t), 4);
     queue_init(&driveratio_queue, sizeof(float), 4);  
+    queue_init(&softlimits_queue, sizeof(softlimits_t), 4);
+    queue_init(&threadstart_queue, sizeof(threadstart_t), 4);
+    queue_init(&armstart_queue, sizeof(bool), 4);
+    queue_init(&taper_queue, sizeof(int32_t), 4);
+    queue_init(&steptiming_queue, sizeof(steptiming_t), 4);
     doorbell_core_command = multicore_doorbell_claim_unused((1 << NUM_CORES) - 1, true);
     doorbell_core_status = multicore_doorbell_claim_unused((1 << NUM_CORES) - 1, true);
 }
 
-bool CrossCoreMessaging :: checkCoreStatus( uint16_t *rpm, bool *isAlarm, bool *powerOn, bool *isPanic ) {
+bool CrossCoreMessaging :: checkCoreStatus( uint16_t *rpm, bool *isAlarm, bool *powerOn, bool *isPanic, uint8_t *headroom, uint32_t *maxStepRate, int32_t *velocity, int32_t *acceleration, int32_t *spindleAngle, uint32_t *encoderErrors ) {
     
     corestatus_t coreStatus;
     if(queue_try_remove(&corestatus_queue, &coreStatus)) {
@@ -44,6 +49,12 @@ bool CrossCoreMessaging :: checkCoreStatus( uint16_t *rpm, bool *isAlarm, bool *
         *isAlarm = coreStatus.isAlarm;
         *powerOn = coreStatus.powerOn;
         *isPanic = coreStatus.isPanic;
+        *headroom = coreStatus.headroom;
+        *maxStepRate = coreStatus.maxStepRate;
+        *velocity = coreStatus.velocity;
+        *acceleration = coreStatus.acceleration;
+        *spindleAngle = coreStatus.spindleAngle;
+        *encoderErrors = coreStatus.encoderErrors;
         if (queue_is_empty(&corestatus_queue)) {
             multicore_doorbell_clear_current_core(doorbell_core_status);
         }
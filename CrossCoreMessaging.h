@@ -39,8 +39,31 @@ private:
         bool powerOn;
         uint16_t rpm;
         bool isPanic;
+        uint8_t headroom;
+        uint32_t maxStepRate;
+        int32_t velocity;
+        int32_t acceleration;
+        int32_t spindleAngle;
+        uint32_t encoderErrors;
     } corestatus_t;
 
+    typedef struct {
+        uint16_t starts;
+        uint16_t start;
+    } threadstart_t;
+
+    typedef struct {
+        bool enabled;
+        int32_t lower;
+        int32_t upper;
+    } softlimits_t;
+
+    typedef struct {
+        uint32_t pulseNs;
+        uint32_t spaceNs;
+        uint32_t maxStepRateHz;
+    } steptiming_t;
+
     bool commandQueuesEmpty(void);
 
 public:
@@ -49,14 +72,24 @@ public:
     void pushFeedCommand(const FEED_THREAD*);
     void pushPowerOnCommand(bool);
     void pushReverseCommand(bool);
-    void pushCoreStatus(uint16_t*, bool*, bool*, bool*);
+    void pushCoreStatus(uint16_t*, bool*, bool*, bool*, uint8_t*, uint32_t*, int32_t*, int32_t*, int32_t*, uint32_t*);
     void pushDriveRatioCommand(float);
+    void pushSoftLimitsCommand(bool, int32_t, int32_t);
+    void pushThreadStartCommand(uint16_t, uint16_t);
+    void pushArmStartCommand(bool);
+    void pushTaperCommand(int32_t);
+    void pushStepTimingCommand(uint32_t, uint32_t, uint32_t);
 
-    bool checkCoreStatus(uint16_t*, bool*, bool*, bool*);
+    bool checkCoreStatus(uint16_t*, bool*, bool*, bool*, uint8_t*, uint32_t*, int32_t*, int32_t*, int32_t*, uint32_t*);
     bool checkFeedCommand(FEED_THREAD*);
     bool checkPowerOnCommand(bool*);
     bool checkReverseCommand(bool*);
     bool checkDriveRatioCommand(float*);
+    bool checkSoftLimitsCommand(bool*, int32_t*, int32_t*);
+    bool checkThreadStartCommand(uint16_t*, uint16_t*);
+    bool checkArmStartCommand(bool*);
+    bool checkTaperCommand(int32_t*);
+    bool checkStepTimingCommand(uint32_t*, uint32_t*, uint32_t*);
 
     uint getDoorbellIrqNum(void);
 
@@ -65,6 +98,11 @@ public:
     queue_t reverse_queue;
     queue_t corestatus_queue;
     queue_t driveratio_queue;
+    queue_t softlimits_queue;
+    queue_t threadstart_queue;
+    queue_t armstart_queue;
+    queue_t taper_queue;
+    queue_t steptiming_queue;
     int doorbell_core_command;
     int doorbell_core_status;
 };
@@ -89,12 +127,46 @@ inline void CrossCoreMessaging :: pushDriveRatioCommand( float driveRatio ) {
     multicore_doorbell_set_other_core(doorbell_core_command);
 }
 
-inline void CrossCoreMessaging :: pushCoreStatus( uint16_t *rpm, bool *isAlarm, bool *powerOn, bool *isPanic) {
+inline void CrossCoreMessaging :: pushSoftLimitsCommand( bool enabled, int32_t lower, int32_t upper ) {
+    softlimits_t limits = { enabled, lower, upper };
+    queue_try_add(&softlimits_queue, &limits);
+    multicore_doorbell_set_other_core(doorbell_core_command);
+}
+
+inline void CrossCoreMessaging :: pushThreadStartCommand( uint16_t starts, uint16_t start ) {
+    threadstart_t threadStart = { starts, start };
+    queue_try_add(&threadstart_queue, &threadStart);
+    multicore_doorbell_set_other_core(doorbell_core_command);
+}
+
+inline void CrossCoreMessaging :: pushArmStartCommand( bool armed ) {
+    queue_try_add(&armstart_queue, &armed);
+    multicore_doorbell_set_other_core(doorbell_core_command);
+}
+
+inline void CrossCoreMessaging :: pushTaperCommand( int32_t arcminutes ) {
+    queue_try_add(&taper_queue, &arcminutes);
+    multicore_doorbell_set_other_core(doorbell_core_command);
+}
+
+inline void CrossCoreMessaging :: pushStepTimingCommand( uint32_t pulseNs, uint32_t spaceNs, uint32_t maxStepRateHz ) {
+    steptiming_t timing = { pulseNs, spaceNs, maxStepRateHz };
+    queue_try_add(&steptiming_queue, &timing);
+    multicore_doorbell_set_other_core(doorbell_core_command);
+}
+
+inline void CrossCoreMessaging :: pushCoreStatus( uint16_t *rpm, bool *isAlarm, bool *powerOn, bool *isPanic, uint8_t *headroom, uint32_t *maxStepRate, int32_t *velocity, int32_t *acceleration, int32_t *spindleAngle, uint32_t *encoderErrors) {
     corestatus_t coreStatus = {};
     coreStatus.rpm = *rpm;
     coreStatus.isAlarm = *isAlarm;
     coreStatus.powerOn = *powerOn;
     coreStatus.isPanic = *isPanic;
+    coreStatus.headroom = *headroom;
+    coreStatus.maxStepRate = *maxStepRate;
+    coreStatus.velocity = *velocity;
+    coreStatus.acceleration = *acceleration;
+    coreStatus.spindleAngle = *spindleAngle;
+    coreStatus.encoderErrors = *encoderErrors;
     queue_try_add(&corestatus_queue, &coreStatus);
     multicore_doorbell_set_other_core(doorbell_core_status);
 }
@@ -102,7 +174,12 @@ inline void CrossCoreMessaging :: pushCoreStatus( uint16_t *rpm, bool *isAlarm,
 inline bool CrossCoreMessaging :: commandQueuesEmpty(void) {
     return queue_is_empty(&feed_queue) && 
         queue_is_empty(&poweron_queue) && 
-        queue_is_empty(&reverse_queue);
+        queue_is_empty(&reverse_queue) &&
+        queue_is_empty(&softlimits_queue) &&
+        queue_is_empty(&threadstart_queue) &&
+        queue_is_empty(&armstart_queue) &&
+        queue_is_empty(&taper_queue) &&
+        queue_is_empty(&steptiming_queue);
 }
 
 inline bool CrossCoreMessaging :: checkFeedCommand(FEED_THREAD* feed) {
@@ -137,6 +214,63 @@ inline bool CrossCoreMessaging :: checkDriveRatioCommand( float* driveRatio ) {
     return rv;
 }
 
+inline bool CrossCoreMessaging :: checkSoftLimitsCommand( bool* enabled, int32_t* lower, int32_t* upper ) {
+    softlimits_t limits;
+    bool rv = queue_try_remove(&softlimits_queue, &limits);
+    if(rv) {
+        *enabled = limits.enabled;
+        *lower = limits.lower;
+        *upper = limits.upper;
+    }
+    if(commandQueuesEmpty()) {
+        multicore_doorbell_clear_current_core(doorbell_core_command);
+    }
+    return rv;
+}
+
+inline bool CrossCoreMessaging :: checkThreadStartCommand( uint16_t* starts, uint16_t* start ) {
+    threadstart_t threadStart;
+    bool rv = queue_try_remove(&threadstart_queue, &threadStart);
+    if(rv) {
+        *starts = threadStart.starts;
+        *start = threadStart.start;
+    }
+    if(commandQueuesEmpty()) {
+        multicore_doorbell_clear_current_core(doorbell_core_command);
+    }
+    return rv;
+}
+
+inline bool CrossCoreMessaging :: checkArmStartCommand( bool* armed ) {
+    bool rv = queue_try_remove(&armstart_queue, armed);
+    if(commandQueuesEmpty()) {
+        multicore_doorbell_clear_current_core(doorbell_core_command);
+    }
+    return rv;
+}
+
+inline bool CrossCoreMessaging :: checkTaperCommand( int32_t* arcminutes ) {
+    bool rv = queue_try_remove(&taper_queue, arcminutes);
+    if(commandQueuesEmpty()) {
+        multicore_doorbell_clear_current_core(doorbell_core_command);
+    }
+    return rv;
+}
+
+inline bool CrossCoreMessaging :: checkStepTimingCommand( uint32_t* pulseNs, uint32_t* spaceNs, uint32_t* maxStepRateHz ) {
+    steptiming_t timing;
+    bool rv = queue_try_remove(&steptiming_queue, &timing);
+    if(rv) {
+        *pulseNs = timing.pulseNs;
+        *spaceNs = timing.spaceNs;
+        *maxStepRateHz = timing.maxStepRateHz;
+    }
+    if(commandQueuesEmpty()) {
+        multicore_doorbell_clear_current_core(doorbell_core_command);
+    }
+    return rv;
+}
+
 inline uint CrossCoreMessaging :: getDoorbellIrqNum(void) {
     return multicore_doorbell_irq_num(doorbell_core_command);
 }
@@ -28,13 +28,37 @@
 // SOFTWARE.
 
 #include <cmath>
+#include <algorithm>
 #include "Encoder.h"
 #include "Configuration.h"
+#include "hardware/clocks.h"
 
 Encoder :: Encoder( void )
 {
-    previous = 0;
-    rpm = 0;
+    sequence = 0;
+    snapshot = {};
+    indexed = false;
+    indexPosition = 0;
+    indexErrors = 0;
+#ifdef ENCODER_INDEX
+    indexDiscard = 0;
+    indexTail = 0;
+    indexForward = true;
+    indexReversed = false;
+#endif
+    edgePeriod = 0;
+    edgeTime = 0;
+#ifdef ENCODER_EDGE_TIMESTAMPS
+    edgeCount = 0;
+    edgePosition = 0;
+    edgeValid = false;
+    cyclesPerSecond = 1;
+#endif
+    extendedPosition = 0;
+    previousCount = 0;
+#ifdef ENCODER_DMA_MIRROR
+    mirror = 0;
+#endif
 }
 
 void Encoder :: initHardware(void)
@@ -43,11 +67,83 @@ void Encoder :: initHardware(void)
     this->pio_sm = 0; 
     pio_sm_claim(this->pio, this->pio_sm);   
     pio_add_program_at_offset(pio, &quadrature_encoder_program, 0); // This PIO code must be loaded at address 0 because it uses computed jumps
+#ifdef ENCODER_DMA_MIRROR
+    quadrature_encoder_program_init(this->pio, this->pio_sm, QUADRATURE_B_PIN, ENCODER_MAX_COUNT_RATE);
+
+    // copy each count the state machine pushes over the same RAM word, for
+    // ever: the channel re-triggers itself each time its count runs out
+    mirror_channel = dma_claim_unused_channel(true);
+    dma_channel_config dc = dma_channel_get_default_config(mirror_channel);
+    channel_config_set_transfer_data_size(&dc, DMA_SIZE_32);
+    channel_config_set_read_increment(&dc, false);
+    channel_config_set_write_increment(&dc, false);
+    channel_config_set_dreq(&dc, pio_get_dreq(pio, pio_sm, false));
+    dma_channel_configure(mirror_channel, &dc, &mirror, &pio->rxf[pio_sm],
+                          dma_encode_transfer_count_with_self_trigger(ENCODER_DMA_RELOAD), true);
+#else
     quadrature_encoder_program_init(this->pio, this->pio_sm, QUADRATURE_B_PIN, 0);
+#endif
+
+#ifdef MOTION_EVENT_DRIVEN
+    // raise PIO IRQ 0 every MOTION_TRIGGER_COUNTS counts to wake the motion loop
+    uint trigger_sm = pio_claim_unused_sm(pio, true);
+    uint trigger_offset = pio_add_program(pio, &encoder_trigger_program);
+    encoder_trigger_program_init(pio, trigger_sm, trigger_offset, QUADRATURE_A_PIN, MOTION_TRIGGER_COUNTS / 4);
+    pio_set_irq0_source_enabled(pio, pis_interrupt0, true);
+#endif
+
+#ifdef ENCODER_EDGE_TIMESTAMPS
+    // timestamp channel A edges on a PIO of their own, at the full system
+    // clock, into a ring that DMA keeps filling for ever
+    PIO edge_pio = pio2;
+    uint edge_sm = pio_claim_unused_sm(edge_pio, true);
+    uint edge_offset = pio_add_program(edge_pio, &encoder_timestamp_program);
+    encoder_timestamp_program_init(edge_pio, edge_sm, edge_offset, QUADRATURE_A_PIN);
+    cyclesPerSecond = clock_get_hz(clk_sys);
+
+    edge_channel = dma_claim_unused_channel(true);
+    dma_channel_config ec = dma_channel_get_default_config(edge_channel);
+    channel_config_set_transfer_data_size(&ec, DMA_SIZE_32);
+    channel_config_set_read_increment(&ec, false);
+    channel_config_set_write_increment(&ec, true);
+    channel_config_set_ring(&ec, true, ENCODER_EDGE_RING_BITS + 2);
+    channel_config_set_dreq(&ec, pio_get_dreq(edge_pio, edge_sm, false));
+    dma_channel_configure(edge_channel, &ec, edgeRing, &edge_pio->rxf[edge_sm],
+                          dma_encode_transfer_count_with_self_trigger(ENCODER_DMA_RELOAD), true);
+#endif
+
+#ifdef ENCODER_INDEX
+    // each index edge pushes a word; the pace channel takes it off the FIFO
+    // and chains to the latch channel, which copies the mirrored count into
+    // the ring and chains back.  The count is latched within a few bus
+    // cycles of the edge, whatever the CPUs are doing.
+    PIO index_pio = pio2;
+    uint index_sm = pio_claim_unused_sm(index_pio, true);
+    uint index_offset = pio_add_program(index_pio, &encoder_index_program);
+    index_pace_channel = dma_claim_unused_channel(true);
+    index_latch_channel = dma_claim_unused_channel(true);
+
+    dma_channel_config lc = dma_channel_get_default_config(index_latch_channel);
+    channel_config_set_transfer_data_size(&lc, DMA_SIZE_32);
+    channel_config_set_read_increment(&lc, false);
+    channel_config_set_write_increment(&lc, true);
+    channel_config_set_ring(&lc, true, ENCODER_INDEX_RING_BITS + 2);
+    channel_config_set_chain_to(&lc, index_pace_channel);
+    dma_channel_configure(index_latch_channel, &lc, indexRing, &mirror, 1, false);
+
+    dma_channel_config pc = dma_channel_get_default_config(index_pace_channel);
+    channel_config_set_transfer_data_size(&pc, DMA_SIZE_32);
+    channel_config_set_read_increment(&pc, false);
+    channel_config_set_write_increment(&pc, false);
+    channel_config_set_dreq(&pc, pio_get_dreq(index_pio, index_sm, false));
+    channel_config_set_chain_to(&pc, index_latch_channel);
+    dma_channel_configure(index_pace_channel, &pc, &indexDiscard, &index_pio->rxf[index_sm], 1, true);
 
-    add_repeating_timer_ms(-1000/_ENCODER_RPM_CALC_HZ, encoder_timer_callback, this, &timer);
+    encoder_index_program_init(index_pio, index_sm, index_offset, QUADRATURE_Z_PIN);
+#endif
 }
 
+#ifndef ENCODER_DMA_MIRROR
 int32_t Encoder :: getPosition(void)
 {
     #ifdef REVERSE_ENCODER
@@ -56,14 +152,102 @@ int32_t Encoder :: getPosition(void)
         return quadrature_encoder_get_count(this->pio, this->pio_sm);
     #endif
 }
+#endif
 
-bool encoder_timer_callback(repeating_timer *rt)
+#ifdef ENCODER_EDGE_TIMESTAMPS
+//
+// New edges have been timestamped; keep the period between the newest two.
+// Each edge is a full cycle of channel A only if the count moved with it: a
+// spindle at rest rocking across one transition of A also makes a rising
+// edge on every rock, with the count going nowhere.
+//
+void Encoder :: checkEdges(void)
 {
-    Encoder * encoder = static_cast<Encoder *>(rt->user_data);
-    int32_t position = encoder->getPosition();
+    // read the write address between two reads of the same count, so the
+    // two belong to the same transfer
+    dma_channel_hw_t *edge_hw = dma_channel_hw_addr(edge_channel);
+    uint32_t count, write;
+    do {
+        count = (0u - edge_hw->transfer_count) & (ENCODER_DMA_RELOAD - 1);
+        write = edge_hw->write_addr;
+    } while( ((0u - edge_hw->transfer_count) & (ENCODER_DMA_RELOAD - 1)) != count );
+
+    uint32_t edges = (count - edgeCount) & (ENCODER_DMA_RELOAD - 1);
+    int64_t moved = std::abs(extendedPosition - edgePosition);
+    bool turned = std::abs(moved - (int64_t)edges * ENCODER_COUNTS_PER_EDGE) <= ENCODER_COUNTS_PER_EDGE / 2;
 
-    encoder->rpm = (uint16_t)(abs(position - encoder->previous) * _ENCODER_RPM_CALC_HZ * 60 / ENCODER_RESOLUTION);
+    if( !turned ) {
+        edgePeriod = 0;
+    } else if( edgeValid || edges >= 2 ) {
+        // the newest two entries sit just behind the DMA write address
+        uint32_t head = (write - (uint32_t)(uintptr_t)edgeRing) / sizeof(uint32_t);
+        uint32_t latest = edgeRing[(head - 1) & (ENCODER_EDGE_RING_SIZE - 1)];
+        uint32_t previous = edgeRing[(head - 2) & (ENCODER_EDGE_RING_SIZE - 1)];
+        edgePeriod = encoder_timestamp_TICK_CYCLES * (latest - previous) + encoder_timestamp_EDGE_CYCLES;
+    }
 
-    encoder->previous = position;
-    return true;
-}
\ No newline at end of file
+    // an edge after a rejected one is timed from a rock, not a full cycle
+    edgeValid = turned;
+    edgeCount = count;
+    edgePosition = extendedPosition;
+    edgeTime = time_us_32();
+}
+
+//
+// Spindle speed from the latest edge period in a snapshot, in encoder counts
+// per second, without direction.  Once the next edge is overdue the speed
+// can only be lower, so the time since the last edge takes over; after a
+// second with no edge the spindle counts as stopped.  Any core may call this.
+//
+uint32_t Encoder :: getEdgeRate(const ENCODER_SNAPSHOT *snapshot)
+{
+    uint32_t idle = time_us_32() - snapshot->edgeTime;
+    if( snapshot->edgePeriod == 0 || idle >= 1000000 ) {
+        return 0;
+    }
+
+    uint64_t period = std::max((uint64_t)snapshot->edgePeriod, (uint64_t)idle * cyclesPerSecond / 1000000);
+    return (uint32_t)((uint64_t)ENCODER_COUNTS_PER_EDGE * cyclesPerSecond / period);
+}
+#endif
+
+#ifdef ENCODER_INDEX
+//
+// Work through the counts latched since the last call.  From one index pulse
+// to the next the spindle has turned exactly once; any other difference
+// means counts were lost or gained.  Only after a reversal, when the wider
+// pulse is met from its other side or the spindle has gone back through the
+// same pulse, is the difference allowed ENCODER_INDEX_TOLERANCE.
+//
+void Encoder :: checkIndex(void)
+{
+    uint32_t head = (dma_channel_hw_addr(index_latch_channel)->write_addr - (uint32_t)(uintptr_t)indexRing) / sizeof(uint32_t);
+
+    while( indexTail != head ) {
+        // the latch is at most a tick old, so it is close to the current
+        // count and extends the same way
+        uint32_t latched = indexRing[indexTail];
+        #ifdef REVERSE_ENCODER
+            int32_t behind = (int32_t)((uint32_t)previousCount + latched);
+        #else
+            int32_t behind = (int32_t)((uint32_t)previousCount - latched);
+        #endif
+        int64_t position = extendedPosition - behind;
+
+        if( indexed ) {
+            int64_t turned = std::abs(position - indexPosition);
+            bool counted = indexReversed
+                ? std::abs(turned - ENCODER_RESOLUTION) <= ENCODER_INDEX_TOLERANCE || turned <= ENCODER_INDEX_TOLERANCE
+                : turned == ENCODER_RESOLUTION;
+            if( !counted ) {
+                indexErrors++;
+            }
+        }
+        indexPosition = position;
+        indexed = true;
+        indexReversed = false;
+
+        indexTail = (indexTail + 1) & (ENCODER_INDEX_RING_SIZE - 1);
+    }
+}
+#endif
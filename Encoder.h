@@ -33,41 +33,271 @@
 #include <cstdint>
 #include "Configuration.h"
 #include "hardware/pio.h"
+#include "hardware/dma.h"
 #include "quadrature_encoder.pio.h"
+#include "encoder_trigger.pio.h"
+#include "encoder_timestamp.pio.h"
+#include "encoder_index.pio.h"
 #include "pico/stdlib.h"
+#include "hardware/sync.h"
 
-#define _ENCODER_MAX_COUNT UINT32_MAX
-#define _ENCODER_RPM_CALC_HZ 10
+// The encoder DMA channels re-trigger themselves after this many transfers;
+// the remaining count doubles as a transfer counter, modulo this
+#define ENCODER_DMA_RELOAD (1u << 27)
 
+// Size of the edge timestamp ring, in words, as a power of two
+#define ENCODER_EDGE_RING_BITS 4
+#define ENCODER_EDGE_RING_SIZE (1 << ENCODER_EDGE_RING_BITS)
+
+// Encoder counts per timestamped edge (one full cycle of channel A)
+#define ENCODER_COUNTS_PER_EDGE 4
+
+// Below this speed the edge period gives a finer spindle speed than the
+// tracking estimator, which sees a new count only every few ticks
+#define ENCODER_EDGE_RATE_MAX_RPM 100
+
+// Size of the index latch ring, in words, as a power of two
+#define ENCODER_INDEX_RING_BITS 3
+#define ENCODER_INDEX_RING_SIZE (1 << ENCODER_INDEX_RING_BITS)
+
+//
+// Spindle state as last published by the motion loop
+//
+typedef struct ENCODER_SNAPSHOT
+{
+    int64_t position;   // monotonic, in encoder counts
+    int32_t velocity;   // filtered, in counts per second
+    int32_t acceleration; // filtered, in counts per second squared
+    uint32_t edgePeriod; // latest edge period in system clock cycles, 0 if none
+    uint32_t edgeTime;   // time_us_32() when that edge was seen
+    bool indexed;       // an index pulse has been seen
+    int64_t indexPosition; // position at the latest index pulse
+    uint32_t indexErrors;  // revolutions that did not add up
+} ENCODER_SNAPSHOT;
+
+//
+// The motion loop is the only reader of the encoder state machine.  It
+// samples on every tick and publishes a snapshot that any core can read
+// without locking: the sequence number is odd while an update is under way,
+// and a reader that sees it odd or changed tries again.
+//
 class Encoder
 {
 private:
-    int32_t previous;
-    uint16_t rpm;
+    volatile uint32_t sequence;
+    ENCODER_SNAPSHOT snapshot;
+
+    //
+    // Monotonic spindle position, extended from the 32-bit hardware count
+    // once per sample so consumers never see a wrap
+    //
+    int64_t extendedPosition;
+    int32_t previousCount;
+
     PIO pio;
     uint32_t pio_sm;
-    repeating_timer timer;
-    friend bool encoder_timer_callback( repeating_timer *rt );
+
+#ifdef ENCODER_DMA_MIRROR
+    //
+    // Latest count from the state machine, kept up to date by DMA
+    //
+    volatile uint32_t mirror;
+    uint mirror_channel;
+#endif
+
+#ifdef ENCODER_EDGE_TIMESTAMPS
+    //
+    // Timestamps of the latest edges, written round the ring by DMA
+    //
+    volatile uint32_t edgeRing[ENCODER_EDGE_RING_SIZE] __attribute__((aligned(ENCODER_EDGE_RING_SIZE * sizeof(uint32_t))));
+    uint edge_channel;
+
+    //
+    // Edges seen so far, modulo ENCODER_DMA_RELOAD, the position when the
+    // last of them was noticed, and whether the spindle really turned to
+    // get there
+    //
+    uint32_t edgeCount;
+    int64_t edgePosition;
+    bool edgeValid;
+    uint32_t cyclesPerSecond;
+
+    void checkEdges( void );
+#endif
+
+    //
+    // Latest edge period, in system clock cycles, and when it was seen
+    //
+    uint32_t edgePeriod;
+    uint32_t edgeTime;
+
+#ifdef ENCODER_INDEX
+    //
+    // Mirrored counts latched by DMA at each index pulse
+    //
+    volatile uint32_t indexRing[ENCODER_INDEX_RING_SIZE] __attribute__((aligned(ENCODER_INDEX_RING_SIZE * sizeof(uint32_t))));
+    volatile uint32_t indexDiscard;
+    uint index_pace_channel;
+    uint index_latch_channel;
+    uint32_t indexTail;
+
+    //
+    // Direction of the last count, and whether it has changed since the
+    // last index pulse
+    //
+    bool indexForward;
+    bool indexReversed;
+
+    void checkIndex( void );
+#endif
+
+    //
+    // Latest index pulse, and how many revolutions between index pulses
+    // were not ENCODER_RESOLUTION counts
+    //
+    bool indexed;
+    int64_t indexPosition;
+    uint32_t indexErrors;
 
 public:
     Encoder( void );
     void initHardware( void );
 
-    uint16_t getRPM( void );
     int32_t getPosition( void );
-    uint32_t getMaxCount( void );
+
+    int64_t sample( void );
+    void publish( int32_t velocity, int32_t acceleration );
+    void getSnapshot( ENCODER_SNAPSHOT *snapshot );
+
+    static int32_t getAngle( const ENCODER_SNAPSHOT *snapshot );
+
+#ifdef ENCODER_DMA_MIRROR
+    uint32_t getSampleCount( void );
+#endif
+
+#ifdef ENCODER_EDGE_TIMESTAMPS
+    uint32_t getEdgeRate( const ENCODER_SNAPSHOT *snapshot );
+#endif
+
+#ifdef MOTION_EVENT_DRIVEN
+    uint getTriggerIrqNum( void );
+    void clearTrigger( void );
+#endif
 };
 
-inline uint32_t Encoder :: getMaxCount(void)
+inline int64_t Encoder :: sample(void)
+{
+    int32_t count = getPosition();
+
+    // unsigned difference is correct across a 32-bit wrap in either direction
+    int32_t moved = (int32_t)((uint32_t)count - (uint32_t)previousCount);
+    extendedPosition += moved;
+    previousCount = count;
+
+#ifdef ENCODER_INDEX
+    if( moved != 0 && (moved > 0) != indexForward ) {
+        indexForward = moved > 0;
+        indexReversed = true;
+    }
+#endif
+
+#ifdef ENCODER_EDGE_TIMESTAMPS
+    // one register read a tick; the work is only done when an edge arrives
+    uint32_t edges = (0u - dma_channel_hw_addr(edge_channel)->transfer_count) & (ENCODER_DMA_RELOAD - 1);
+    if( edges != edgeCount ) {
+        checkEdges();
+    }
+#endif
+
+#ifdef ENCODER_INDEX
+    // the latch ring only moves once a revolution
+    if( dma_channel_hw_addr(index_latch_channel)->write_addr != (uint32_t)(uintptr_t)&indexRing[indexTail] ) {
+        checkIndex();
+    }
+#endif
+
+    return extendedPosition;
+}
+
+//
+// Publish the latest sample, with the motion loop's velocity and
+// acceleration estimates.  Only the sampling core may call this.
+//
+inline void Encoder :: publish(int32_t velocity, int32_t acceleration)
+{
+    sequence = sequence + 1;
+    __dmb();
+    snapshot.position = extendedPosition;
+    snapshot.velocity = velocity;
+    snapshot.acceleration = acceleration;
+    snapshot.edgePeriod = edgePeriod;
+    snapshot.edgeTime = edgeTime;
+    snapshot.indexed = indexed;
+    snapshot.indexPosition = indexPosition;
+    snapshot.indexErrors = indexErrors;
+    __dmb();
+    sequence = sequence + 1;
+}
+
+//
+// Consistent copy of the last published sample, from any core.  Must not
+// interrupt the publisher on its own core.
+//
+inline void Encoder :: getSnapshot(ENCODER_SNAPSHOT *copy)
+{
+    uint32_t before;
+    do {
+        before = sequence;
+        __dmb();
+        *copy = snapshot;
+        __dmb();
+    } while( (before & 1) != 0 || sequence != before );
+}
+
+#ifdef ENCODER_DMA_MIRROR
+inline int32_t Encoder :: getPosition(void)
+{
+    // one load; the count is at most one state machine loop old
+    #ifdef REVERSE_ENCODER
+        return -(int32_t)mirror;
+    #else
+        return (int32_t)mirror;
+    #endif
+}
+
+//
+// Samples the state machine has produced, modulo ENCODER_DMA_RELOAD.  A
+// count that stops advancing means the encoder state machine has stalled.
+//
+inline uint32_t Encoder :: getSampleCount(void)
 {
-    return _ENCODER_MAX_COUNT;
+    return (0u - dma_channel_hw_addr(mirror_channel)->transfer_count) & (ENCODER_DMA_RELOAD - 1);
 }
+#endif
 
-inline uint16_t Encoder :: getRPM(void)
+#ifdef MOTION_EVENT_DRIVEN
+inline uint Encoder :: getTriggerIrqNum(void)
 {
-    return rpm;
+    return pio_get_irq_num(pio, 0);
 }
 
-bool encoder_timer_callback( repeating_timer *rt );
+inline void Encoder :: clearTrigger(void)
+{
+    pio_interrupt_clear(pio, 0);
+}
+#endif
+
+//
+// Spindle angle in counts past the index, 0 to ENCODER_RESOLUTION - 1, or -1
+// before the first index pulse
+//
+inline int32_t Encoder :: getAngle(const ENCODER_SNAPSHOT *snapshot)
+{
+    if( !snapshot->indexed ) {
+        return -1;
+    }
+    int32_t angle = (int32_t)((snapshot->position - snapshot->indexPosition) % ENCODER_RESOLUTION);
+    return angle < 0 ? angle + ENCODER_RESOLUTION : angle;
+}
 
 #endif // __ENCODER_H
\ No newline at end of file
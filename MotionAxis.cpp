@@ -0,0 +1,53 @@
+// Pico Electronic Leadscrew
+// https://github.com/funkenjaeger/pico-els
+//
+// MIT License
+//
+// Copyright (c) 2025 Evan Dudzik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MotionAxis.h"
+
+MotionAxis :: MotionAxis(void) : syncFollower(FOLLOWER_ACCELERATION)
+{
+    stepperDrive = nullptr;
+    ratioChanged = false;
+    limitsChanged = false;
+    heldSteps = 0;
+    commandedSteps = 0;
+    compensation = nullptr;
+}
+
+void MotionAxis :: attach(StepperDrive *stepperDrive)
+{
+    this->stepperDrive = stepperDrive;
+}
+
+//
+// Stop the axis at lower/upper, in steps of its commanded position.  The
+// check and the braking happen in the ISR.
+//
+void MotionAxis :: setSoftLimits(bool enabled, int32_t lower, int32_t upper)
+{
+    this->pendingLimitsEnabled = enabled;
+    this->pendingLowerLimit = lower;
+    this->pendingUpperLimit = upper;
+    this->limitsChanged = true;
+}
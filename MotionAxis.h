@@ -0,0 +1,160 @@
+// Pico Electronic Leadscrew
+// https://github.com/funkenjaeger/pico-els
+//
+// MIT License
+//
+// Copyright (c) 2025 Evan Dudzik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __MOTIONAXIS_H
+#define __MOTIONAXIS_H
+
+#include <cstdint>
+#include "StepperDrive.h"
+#include "RatioEngine.h"
+#include "SyncFollower.h"
+#include "PitchCompensation.h"
+
+//
+// One stepper axis slaved to the spindle: its own ratio, follower and soft
+// limits in front of its own drive.  Core runs every axis from the same
+// spindle position on each tick.
+//
+class MotionAxis
+{
+private:
+    StepperDrive *stepperDrive;
+
+    RatioEngine ratioEngine;
+    SyncFollower syncFollower;
+
+    //
+    // Ratio and soft limits prepared by the setters, picked up on the next
+    // update
+    //
+    RATIO pendingRatio;
+    volatile bool ratioChanged;
+    bool pendingLimitsEnabled;
+    int32_t pendingLowerLimit;
+    int32_t pendingUpperLimit;
+    volatile bool limitsChanged;
+
+    //
+    // Position the axis waits at while an armed start holds it
+    //
+    int32_t heldSteps;
+    int32_t commandedSteps;
+
+    //
+    // Screw pitch error correction applied on the way to the drive, if any
+    //
+    const PitchCompensation *compensation;
+
+public:
+    MotionAxis(void);
+
+    void attach(StepperDrive *stepperDrive);
+    StepperDrive *getDrive(void);
+    void setCompensation(const PitchCompensation *compensation);
+
+    void setRatio(const RATIO *ratio);
+    void setSoftLimits(bool enabled, int32_t lower, int32_t upper);
+
+    void engage(bool fromRest);
+    void hold(void);
+    void release(int64_t position);
+
+    void update(int64_t position, bool holding, uint32_t ticks);
+};
+
+inline StepperDrive *MotionAxis :: getDrive(void)
+{
+    return stepperDrive;
+}
+
+inline void MotionAxis :: setCompensation(const PitchCompensation *compensation)
+{
+    this->compensation = compensation;
+}
+
+inline void MotionAxis :: setRatio(const RATIO *ratio)
+{
+    this->pendingRatio = *ratio;
+    this->ratioChanged = true;
+}
+
+inline void MotionAxis :: engage(bool fromRest)
+{
+    syncFollower.engage(fromRest, stepperDrive->getMaxStepRate());
+}
+
+//
+// Brake and come back to the current commanded position until released
+//
+inline void MotionAxis :: hold(void)
+{
+    heldSteps = commandedSteps;
+    engage(false);
+}
+
+//
+// Anchor the engine so the held position corresponds to this spindle
+// position, and engage from there
+//
+inline void MotionAxis :: release(int64_t position)
+{
+    ratioEngine.reset(position, heldSteps);
+    engage(true);
+}
+
+//
+// Advance the axis by ticks motion ticks to the spindle position
+//
+inline void MotionAxis :: update(int64_t position, bool holding, uint32_t ticks)
+{
+    int32_t desiredSteps = holding ? heldSteps : ratioEngine.update(position);
+
+    // a new ratio takes effect from the current spindle position; the
+    // engine keeps its step count and phase, so there is no step to absorb.
+    // The carriage cannot change speed instantly, so ramp into it.
+    if( ratioChanged ) {
+        ratioEngine.setRatio(&pendingRatio);
+        ratioChanged = false;
+        engage(false);
+    }
+    if( limitsChanged ) {
+        if( pendingLimitsEnabled ) {
+            syncFollower.setLimits(pendingLowerLimit, pendingUpperLimit);
+        } else {
+            syncFollower.clearLimits();
+        }
+        limitsChanged = false;
+    }
+
+    // limits and holds work on the ideal position; only the drive sees the
+    // corrected one
+    commandedSteps = syncFollower.update(desiredSteps, ticks);
+    stepperDrive->setDesiredPosition(compensation != nullptr ? compensation->apply(commandedSteps) : commandedSteps);
+
+    // service the stepper drive state machine
+    stepperDrive->move(ticks);
+}
+
+#endif // __MOTIONAXIS_H
@@ -35,13 +35,28 @@ void MulticoreCore :: pollStatus( void )
     bool isAlarm = Core::getIsAlarm();
     bool isPowerOn = Core::getIsPowerOn();
     bool isPanic = Core::getIsPanic();
-    xCore->pushCoreStatus(&rpm, &isAlarm, &isPowerOn, &isPanic);
+    uint8_t headroom = Core::getHeadroom();
+    uint32_t maxStepRate = Core::getMaxStepRate();
+    int32_t velocity = Core::getVelocity();
+    int32_t acceleration = Core::getAcceleration();
+    int32_t spindleAngle = Core::getSpindleAngle();
+    uint32_t encoderErrors = Core::getEncoderErrors();
+    xCore->pushCoreStatus(&rpm, &isAlarm, &isPowerOn, &isPanic, &headroom, &maxStepRate, &velocity, &acceleration,
+                          &spindleAngle, &encoderErrors);
 }
 
 void MulticoreCore :: checkQueues( void ) {  
     FEED_THREAD feed;
     bool powerOn, reverse;
     float driveRatio;
+    bool limitsEnabled;
+    int32_t lowerLimit, upperLimit;
+    uint16_t starts, start;
+    bool armed;
+#ifdef CROSS_AXIS
+    int32_t taper;
+#endif
+    uint32_t pulseNs, spaceNs, maxStepRateHz;
     
     if(xCore->checkFeedCommand(&feed)) {
         setFeed(&feed);
@@ -55,4 +70,21 @@ void MulticoreCore :: checkQueues( void ) {
     if(xCore->checkDriveRatioCommand(&driveRatio)) {
         setDriveRatio(driveRatio);
     }
+    if(xCore->checkSoftLimitsCommand(&limitsEnabled, &lowerLimit, &upperLimit)) {
+        setSoftLimits(limitsEnabled, lowerLimit, upperLimit);
+    }
+    if(xCore->checkThreadStartCommand(&starts, &start)) {
+        setThreadStart(starts, start);
+    }
+    if(xCore->checkArmStartCommand(&armed)) {
+        armStart(armed);
+    }
+#ifdef CROSS_AXIS
+    if(xCore->checkTaperCommand(&taper)) {
+        setTaper(taper);
+    }
+#endif
+    if(xCore->checkStepTimingCommand(&pulseNs, &spaceNs, &maxStepRateHz)) {
+        setStepTiming(pulseNs, spaceNs, maxStepRateHz);
+    }
 }
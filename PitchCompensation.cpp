@@ -0,0 +1,41 @@
+// Pico Electronic Leadscrew
+// https://github.com/funkenjaeger/pico-els
+//
+// MIT License
+//
+// Copyright (c) 2025 Evan Dudzik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "PitchCompensation.h"
+
+//
+// points is the number of corrections in the table, at least two.  The
+// table must outlive the compensation; a const table stays in flash.
+//
+PitchCompensation :: PitchCompensation(const int16_t *table, uint32_t points, uint32_t segmentBits, int32_t origin)
+{
+    this->table = table;
+    this->origin = origin;
+    this->segmentBits = segmentBits;
+
+    // stop one step short of the last point, so the interpolation never
+    // reads past the end of the table
+    this->span = (int32_t)(((points - 1) << segmentBits) - 1);
+}
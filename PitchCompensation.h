@@ -0,0 +1,72 @@
+// Pico Electronic Leadscrew
+// https://github.com/funkenjaeger/pico-els
+//
+// MIT License
+//
+// Copyright (c) 2025 Evan Dudzik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __PITCHCOMPENSATION_H
+#define __PITCHCOMPENSATION_H
+
+#include <cstdint>
+#include <algorithm>
+#include "Configuration.h"
+
+// Corrections are in steps with this many fractional bits
+#define PITCH_CORRECTION_SHIFT 8
+
+//
+// Maps a commanded leadscrew position to the one that puts the carriage
+// where it should be, from a table of corrections at evenly spaced points.
+// Segments are a power of two steps long, so the lookup is a shift, a mask
+// and one multiply, whatever the position.
+//
+class PitchCompensation
+{
+private:
+    const int16_t *table;
+    int32_t origin;
+    uint32_t segmentBits;
+
+    //
+    // Last position interpolated inside the table, relative to the origin
+    //
+    int32_t span;
+
+public:
+    PitchCompensation(const int16_t *table, uint32_t points, uint32_t segmentBits, int32_t origin);
+
+    int32_t apply(int32_t steps) const;
+};
+
+inline int32_t PitchCompensation :: apply(int32_t steps) const
+{
+    // positions off either end take the end correction
+    int32_t offset = std::clamp(steps - origin, (int32_t)0, span);
+    uint32_t index = (uint32_t)offset >> segmentBits;
+    int32_t fraction = offset & ((1 << segmentBits) - 1);
+
+    int32_t correction = table[index]
+        + (((table[index + 1] - table[index]) * fraction) >> segmentBits);
+    return steps + ((correction + (1 << (PITCH_CORRECTION_SHIFT - 1))) >> PITCH_CORRECTION_SHIFT);
+}
+
+#endif // __PITCHCOMPENSATION_H
@@ -0,0 +1,107 @@
+// Pico Electronic Leadscrew
+// https://github.com/funkenjaeger/pico-els
+//
+// MIT License
+//
+// Copyright (c) 2025 Evan Dudzik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "RatioEngine.h"
+
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+    while( b != 0 ) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+RatioEngine :: RatioEngine(void)
+{
+    ratio = makeRatio(0, 1, 0);
+    previousPosition = 0;
+    steps = 0;
+    phase = 0;
+}
+
+RATIO RatioEngine :: makeRatio(uint64_t numerator, uint64_t denominator, int32_t direction)
+{
+    RATIO r = {};
+
+    if( numerator == 0 || denominator == 0 ) {
+        r.denominator = 1;
+        r.direction = direction;
+        return r;
+    }
+
+    uint64_t divisor = gcd(numerator, denominator);
+    numerator /= divisor;
+    denominator /= divisor;
+
+    // an irreducible denominator this large can only come from an unusual
+    // drive ratio; give up the last bits of precision rather than overflow
+    while( denominator > UINT32_MAX ) {
+        numerator >>= 1;
+        denominator >>= 1;
+    }
+
+    r.whole = (uint32_t)(numerator / denominator);
+    r.remainder = (uint32_t)(numerator % denominator);
+    r.denominator = (uint32_t)denominator;
+    r.direction = direction;
+    return r;
+}
+
+void RatioEngine :: fromFloat(float value, uint32_t *numerator, uint32_t *denominator)
+{
+    // best rational approximation by continued fractions; exact for the
+    // binary fractions gear ratios are normally given as (1.5625 = 25/16)
+    uint64_t h0 = 0, h1 = 1;
+    uint64_t k0 = 1, k1 = 0;
+    double x = value;
+
+    if( !(value > 0.0f) ) {
+        *numerator = 0;
+        *denominator = 1;
+        return;
+    }
+
+    for( int i = 0; i < 32; i++ ) {
+        uint64_t a = (uint64_t)x;
+        uint64_t h2 = a * h1 + h0;
+        uint64_t k2 = a * k1 + k0;
+        if( k2 > RATIO_MAX_FLOAT_DENOMINATOR || h2 > UINT32_MAX ) {
+            break;
+        }
+        h0 = h1; h1 = h2;
+        k0 = k1; k1 = k2;
+
+        double fraction = x - (double)a;
+        if( fraction < 1e-6 ) {
+            break;
+        }
+        x = 1.0 / fraction;
+    }
+
+    *numerator = (uint32_t)h1;
+    *denominator = (uint32_t)k1;
+}
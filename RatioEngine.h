@@ -0,0 +1,138 @@
+// Pico Electronic Leadscrew
+// https://github.com/funkenjaeger/pico-els
+//
+// MIT License
+//
+// Copyright (c) 2025 Evan Dudzik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __RATIOENGINE_H
+#define __RATIOENGINE_H
+
+#include <cstdint>
+#include "Configuration.h"
+
+// Largest denominator used when converting a floating-point drive ratio
+// into an exact fraction
+#define RATIO_MAX_FLOAT_DENOMINATOR 10000
+
+//
+// Spindle-to-stepper ratio in the form consumed by the phase accumulator:
+// every encoder count advances the output by whole + remainder/denominator
+// steps.  Built off the hot path by RatioEngine::makeRatio().
+//
+typedef struct RATIO
+{
+    uint32_t whole;
+    uint32_t remainder;
+    uint32_t denominator;
+    int32_t direction;
+} RATIO;
+
+// Most encoder counts one pass of the motion loop can consume: the fastest
+// the count can change, over the longest the loop can go between passes
+#define RATIO_MAX_COUNTS_PER_PASS ((uint64_t)ENCODER_MAX_COUNT_RATE * MOTION_FALLBACK_US / 1000000 + 1)
+
+// The phase accumulator must absorb the largest count delta of one pass
+// times the largest remainder, on top of a phase just short of the
+// denominator, before the carry loop brings it back into range
+static_assert(RATIO_MAX_COUNTS_PER_PASS * UINT32_MAX + UINT32_MAX <= (uint64_t)INT64_MAX,
+    "phase accumulator can overflow at ENCODER_MAX_COUNT_RATE");
+static_assert(RATIO_MAX_COUNTS_PER_PASS <= (uint64_t)INT32_MAX,
+    "one pass of encoder counts does not fit the ratio engine's delta");
+
+class RatioEngine
+{
+private:
+    RATIO ratio;
+
+    //
+    // Last spindle position consumed, in encoder counts
+    //
+    int64_t previousPosition;
+
+    //
+    // Accumulated output, in steps
+    //
+    int32_t steps;
+
+    //
+    // Fractional step carried between updates, in units of 1/denominator.
+    // Always kept in [0, denominator).
+    //
+    int64_t phase;
+
+public:
+    RatioEngine(void);
+
+    static RATIO makeRatio(uint64_t numerator, uint64_t denominator, int32_t direction);
+    static void fromFloat(float value, uint32_t *numerator, uint32_t *denominator);
+
+    void setRatio(const RATIO *ratio);
+    void reset(int64_t position, int32_t steps);
+
+    int32_t update(int64_t position);
+};
+
+//
+// Switch to a new ratio at the last position consumed.  The step count and
+// the fractional step carried in the phase are kept, so the output continues
+// without a jump and the spindle-to-carriage phase survives the change.
+//
+inline void RatioEngine :: setRatio(const RATIO *ratio)
+{
+    // re-express the fractional step in the new denominator; this runs only
+    // when the ratio changes, never on an ordinary tick
+    this->phase = (int64_t)(((uint64_t)this->phase * ratio->denominator) / this->ratio.denominator);
+    this->ratio = *ratio;
+}
+
+inline void RatioEngine :: reset(int64_t position, int32_t steps)
+{
+    this->previousPosition = position;
+    this->steps = steps;
+    this->phase = 0;
+}
+
+inline int32_t RatioEngine :: update(int64_t position)
+{
+    // the position is monotonic, so the per-tick difference is small and
+    // needs no wrap handling
+    int32_t delta = (int32_t)(position - previousPosition) * ratio.direction;
+    previousPosition = position;
+
+    steps += delta * (int32_t)ratio.whole;
+    phase += (int64_t)delta * ratio.remainder;
+
+    // carry whole steps out of the phase; remainder < denominator, so this
+    // runs at most |delta| times
+    while( phase >= ratio.denominator ) {
+        phase -= ratio.denominator;
+        steps++;
+    }
+    while( phase < 0 ) {
+        phase += ratio.denominator;
+        steps--;
+    }
+
+    return steps;
+}
+
+#endif // __RATIOENGINE_H
@@ -36,6 +36,18 @@
 message(FATAL_ERROR "STEPPER_CYCLE_US must be between 5us and 100us") 
 #endif
 
+#if MOTION_LATENCY_US < 0 || MOTION_LATENCY_US > 1000
+#error MOTION_LATENCY_US must be between 0us and 1000us
+#endif
+
+#if SPINDLE_ESTIMATOR_SHIFT < 6 || SPINDLE_ESTIMATOR_SHIFT > 14
+#error SPINDLE_ESTIMATOR_SHIFT must be between 6 and 14
+#endif
+
+#if MOTION_DEADBAND_COUNTS < 0 || MOTION_DEADBAND_COUNTS > 64
+#error MOTION_DEADBAND_COUNTS must be between 0 and 64
+#endif
+
 #if UI_REFRESH_RATE_HZ < 3 || UI_REFRESH_RATE_HZ > 100
 #error UI_REFRESH_RATE_HZ must be between 1Hz and 100Hz
 #endif
@@ -44,6 +56,56 @@ message(FATAL_ERROR "STEPPER_CYCLE_US must be between 5us and 100us")
 #error RPM_CALC_RATE_HZ must be between 1Hz and 10Hz
 #endif
 
+#ifdef MOTION_EVENT_DRIVEN
+#if MOTION_TRIGGER_COUNTS < 4 || MOTION_TRIGGER_COUNTS > 4096 || MOTION_TRIGGER_COUNTS % 4 != 0
+#error MOTION_TRIGGER_COUNTS must be a multiple of 4 between 4 and 4096
+#endif
+
+#if MOTION_FALLBACK_US < STEPPER_CYCLE_US || MOTION_FALLBACK_US > 10000
+#error MOTION_FALLBACK_US must be between STEPPER_CYCLE_US and 10000us
+#endif
+#endif
+
+#if MAX_THREAD_STARTS < 1 || MAX_THREAD_STARTS > 9
+#error MAX_THREAD_STARTS must be between 1 and 9
+#endif
+
+#if OVERSPEED_WARNING_HEADROOM < 0 || OVERSPEED_WARNING_HEADROOM > 100
+#error OVERSPEED_WARNING_HEADROOM must be between 0 and 100 percent
+#endif
+
+#if STEPPER_DIRECTION_HOLD_NS < 0 || STEPPER_DIRECTION_HOLD_NS > 5000000
+#error STEPPER_DIRECTION_HOLD_NS must be between 0ns and 5000000ns
+#endif
+
+#if STEPPER_DIRECTION_SETUP_NS < 0 || STEPPER_DIRECTION_SETUP_NS > 5000000
+#error STEPPER_DIRECTION_SETUP_NS must be between 0ns and 5000000ns
+#endif
+
+#if STEPPER_PULSE_NS < STEPPER_DRIVER_MIN_PULSE_NS
+#error STEPPER_PULSE_NS must not be shorter than STEPPER_DRIVER_MIN_PULSE_NS
+#endif
+
+#if STEPPER_SPACE_NS < STEPPER_DRIVER_MIN_SPACE_NS
+#error STEPPER_SPACE_NS must not be shorter than STEPPER_DRIVER_MIN_SPACE_NS
+#endif
+
+#if STEPPER_MAX_STEP_RATE_HZ < 1 || STEPPER_MAX_STEP_RATE_HZ > STEPPER_DRIVER_MAX_STEP_RATE_HZ
+#error STEPPER_MAX_STEP_RATE_HZ must be between 1Hz and STEPPER_DRIVER_MAX_STEP_RATE_HZ
+#endif
+
+#if STEPPER_BACKLASH_STEPS < 0 || STEPPER_BACKLASH_STEPS > 10000
+#error STEPPER_BACKLASH_STEPS must be between 0 and 10000
+#endif
+
+#if STEPPER_BACKLASH_RATE_HZ < 100 || STEPPER_BACKLASH_RATE_HZ > STEPPER_MAX_STEP_RATE_HZ
+#error STEPPER_BACKLASH_RATE_HZ must be between 100Hz and STEPPER_MAX_STEP_RATE_HZ
+#endif
+
+#if PITCH_COMPENSATION_SEGMENT_BITS < 4 || PITCH_COMPENSATION_SEGMENT_BITS > 15
+#error PITCH_COMPENSATION_SEGMENT_BITS must be between 4 and 15
+#endif
+
 #if STEPPER_MICROSTEPS < 1 || STEPPER_MICROSTEPS > 256
 #error STEPPER_MICROSTEPS must be between 1 and 256
 #endif
@@ -52,10 +114,37 @@ message(FATAL_ERROR "STEPPER_CYCLE_US must be between 5us and 100us")
 #error STEPPER_RESOLUTION must be between 1 and 2000
 #endif
 
+#if SYNC_ACCELERATION > 10000000
+#error SYNC_ACCELERATION must be at most 10000000 steps/s^2
+#endif
+
+// The follower works in steps per tick squared with FOLLOWER_SHIFT (24)
+// fractional bits; the acceleration must not round down to nothing, which
+// sets the lower bound: about 2385 at 5us, 597 at 10us, 6 at 100us
+#if SYNC_ACCELERATION * STEPPER_CYCLE_US * STEPPER_CYCLE_US * 16777216 < 1000000000000
+#error SYNC_ACCELERATION is too small for STEPPER_CYCLE_US: it must be at least 10^12 / (2^24 * STEPPER_CYCLE_US^2) steps/s^2, about 2385 at 5us
+#endif
+
 #if ENCODER_RESOLUTION < 100 || ENCODER_RESOLUTION > 10000
 #error ENCODER_RESOLUTION must be between 100 and 10000
 #endif
 
+#ifdef ENCODER_DMA_MIRROR
+#if ENCODER_MAX_COUNT_RATE < ENCODER_RESOLUTION * 50 || ENCODER_MAX_COUNT_RATE > 10000000
+#error ENCODER_MAX_COUNT_RATE must cover at least 3000 RPM and be at most 10000000
+#endif
+#endif
+
+#ifdef ENCODER_INDEX
+#ifndef ENCODER_DMA_MIRROR
+#error ENCODER_INDEX requires ENCODER_DMA_MIRROR
+#endif
+
+#if ENCODER_INDEX_TOLERANCE < 0 || ENCODER_INDEX_TOLERANCE > 16
+#error ENCODER_INDEX_TOLERANCE must be between 0 and 16
+#endif
+#endif
+
 #if defined(LEADSCREW_TPI) && defined(LEADSCREW_HMM)
 #error LEADSCREW_TPI and LEADSCREW_HMM may not both be defined.  Choose only one.
 #endif
@@ -72,4 +161,22 @@ message(FATAL_ERROR "STEPPER_CYCLE_US must be between 5us and 100us")
 #endif
 #endif
 
+#ifdef CROSS_AXIS
+#if defined(CROSS_TPI) == defined(CROSS_HMM)
+#error Define exactly one of CROSS_TPI and CROSS_HMM
+#endif
+
+#if CROSS_MICROSTEPS < 1 || CROSS_MICROSTEPS > 256
+#error CROSS_MICROSTEPS must be between 1 and 256
+#endif
+
+#if CROSS_RESOLUTION < 1 || CROSS_RESOLUTION > 2000
+#error CROSS_RESOLUTION must be between 1 and 2000
+#endif
+
+#if TAPER_ANGLE_ARCMIN <= -2700 || TAPER_ANGLE_ARCMIN >= 2700
+#error TAPER_ANGLE_ARCMIN must be between -2700 and 2700 (45 degrees)
+#endif
+#endif
+
 #endif // __SANITYCHECK_H
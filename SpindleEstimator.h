@@ -0,0 +1,137 @@
+// Pico Electronic Leadscrew
+// https://github.com/funkenjaeger/pico-els
+//
+// MIT License
+//
+// Copyright (c) 2025 Evan Dudzik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __SPINDLEESTIMATOR_H
+#define __SPINDLEESTIMATOR_H
+
+#include <cstdint>
+#include <algorithm>
+#include "Configuration.h"
+
+// Fractional bits of the position and velocity estimates, in counts and
+// counts per motion tick
+#define ESTIMATOR_SHIFT 32
+
+// Fractional bits of the acceleration estimate, in counts per tick squared
+#define ESTIMATOR_ACCELERATION_SHIFT 48
+
+// Motion ticks per second
+#define ESTIMATOR_TICK_HZ (1000000 / STEPPER_CYCLE_US)
+
+//
+// Alpha-beta-gamma tracking filter on the spindle position.  Each update
+// predicts forward by the elapsed ticks, then corrects position, velocity and
+// acceleration by fixed shares of the residual.  The shares are the
+// critically damped (fading memory) gains for a memory of about
+// 2^SPINDLE_ESTIMATOR_SHIFT updates, rounded to shifts:
+//
+//     alpha = 3e, beta = 3e^2, 2 gamma = e^3, e = 2^-SPINDLE_ESTIMATOR_SHIFT
+//
+class SpindleEstimator
+{
+private:
+    //
+    // Position estimate: whole counts, plus a fraction in [0, 1) with
+    // ESTIMATOR_SHIFT bits
+    //
+    int64_t position;
+    int64_t fraction;
+
+    //
+    // Counts per tick and counts per tick squared, fixed point
+    //
+    int64_t velocity;
+    int64_t acceleration;
+
+    void carry(void);
+
+public:
+    SpindleEstimator(void);
+
+    void reset(int64_t position);
+    void update(int64_t measured, uint32_t ticks);
+
+    int64_t getVelocity(void);
+    int32_t getCountsPerSecond(void);
+    int32_t getCountsPerSecondSquared(void);
+};
+
+inline void SpindleEstimator :: carry(void)
+{
+    position += fraction >> ESTIMATOR_SHIFT;
+    fraction &= ((int64_t)1 << ESTIMATOR_SHIFT) - 1;
+}
+
+//
+// Advance by ticks motion ticks (at least one) to the measured position
+//
+inline void SpindleEstimator :: update(int64_t measured, uint32_t ticks)
+{
+    int64_t dt = ticks;
+
+    // predict
+    fraction += velocity * dt + ((acceleration * dt * dt) >> (ESTIMATOR_ACCELERATION_SHIFT - ESTIMATOR_SHIFT + 1));
+    velocity += (acceleration * dt) >> (ESTIMATOR_ACCELERATION_SHIFT - ESTIMATOR_SHIFT);
+    carry();
+
+    // correct; a residual of more than 2^28 counts can only follow a reset
+    // of the count.  The clamp keeps 3 * residual, about 3 * 2^60 at most,
+    // inside 64 bits.
+    int64_t error = std::clamp(measured - position, (int64_t)-(1 << 28), (int64_t)(1 << 28));
+    int64_t residual = (error << ESTIMATOR_SHIFT) - fraction;
+    int64_t velocityStep = (3 * residual) >> (2 * SPINDLE_ESTIMATOR_SHIFT);
+    int64_t accelerationStep = residual >> (3 * SPINDLE_ESTIMATOR_SHIFT - (ESTIMATOR_ACCELERATION_SHIFT - ESTIMATOR_SHIFT));
+    if( ticks > 1 ) {
+        velocityStep /= dt;
+        accelerationStep /= dt * dt;
+    }
+
+    fraction += (3 * residual) >> SPINDLE_ESTIMATOR_SHIFT;
+    velocity += velocityStep;
+    acceleration += accelerationStep;
+    carry();
+}
+
+//
+// Counts per tick, with ESTIMATOR_SHIFT fractional bits
+//
+inline int64_t SpindleEstimator :: getVelocity(void)
+{
+    return velocity;
+}
+
+inline int32_t SpindleEstimator :: getCountsPerSecond(void)
+{
+    return (int32_t)((velocity * ESTIMATOR_TICK_HZ) >> ESTIMATOR_SHIFT);
+}
+
+inline int32_t SpindleEstimator :: getCountsPerSecondSquared(void)
+{
+    // in two halves, so the intermediate products stay inside 64 bits
+    int64_t perTick = (acceleration * ESTIMATOR_TICK_HZ) >> (ESTIMATOR_ACCELERATION_SHIFT / 2);
+    return (int32_t)((perTick * ESTIMATOR_TICK_HZ) >> (ESTIMATOR_ACCELERATION_SHIFT / 2));
+}
+
+#endif // __SPINDLEESTIMATOR_H
@@ -29,52 +29,193 @@
 
 
 #include "StepperDrive.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
 
 
+int StepperDrive :: programOffset = -1;
+
 StepperDrive :: StepperDrive(void)
+    : StepperDrive(STEPPER_STEP_PIN, STEPPER_DIRECTION_PIN, STEPPER_ENABLE_PIN, STEPPER_ALARM_PIN)
+{
+}
+
+StepperDrive :: StepperDrive(uint stepPin, uint directionPin, uint enablePin, uint alarmPin)
 {
+    this->stepPin = stepPin;
+    this->directionPin = directionPin;
+    this->enablePin = enablePin;
+    this->alarmPin = alarmPin;
+
     //
     // Set up global state variables
     //
     currentPosition = 0;
     desiredPosition = 0;
+    ticksSinceCommand = 0;
+    previousDir = false;
+    backlashSteps = STEPPER_BACKLASH_STEPS;
+    backlashRemaining = 0;
+    backlashCredit = 0;
+    ringHead = 0;
+    ringCommitted = 0;
+    queuedCycles = 0;
+    tickCycles = 0;
+    minSpacing = 0;
+    directionHoldCycles = 0;
+    directionSetupCycles = 0;
+    maxStepRate = 0;
+    pendingTiming = {};
+    timingChanged = false;
+
+    burstReciprocal[0] = 0;
+    for( uint32_t n = 1; n <= STEPPER_MAX_BURST; n++ ) {
+        burstReciprocal[n] = 65536 / n;
+    }
 }
 
 void StepperDrive :: initHardware(void)
 {    
-    gpio_init(STEPPER_DIRECTION_PIN);
-    gpio_init(STEPPER_ENABLE_PIN);
-    gpio_init(STEPPER_ALARM_PIN);
-    gpio_put(STEPPER_DIRECTION_PIN, false);
-    gpio_put(STEPPER_ENABLE_PIN, false);
-    gpio_set_dir(STEPPER_DIRECTION_PIN, GPIO_OUT);
-    gpio_set_dir(STEPPER_ENABLE_PIN, GPIO_OUT);
-    gpio_set_dir(STEPPER_ALARM_PIN, GPIO_IN);
-    gpio_pull_up(STEPPER_ALARM_PIN);
-
-    // stepper pio
+    gpio_init(enablePin);
+    gpio_init(alarmPin);
+    gpio_put(enablePin, false);
+    gpio_set_dir(enablePin, GPIO_OUT);
+    gpio_set_dir(alarmPin, GPIO_IN);
+    gpio_pull_up(alarmPin);
+
+    // stepper pio; drives both step and direction, so direction changes
+    // are timed against the step pulses without the ISR waiting
     pio = pio0;
     pio_sm = pio_claim_unused_sm(pio, true);
-    int stm_offset = pio_add_program(pio, &stepper_program);
-    stepper_program_init(pio, pio_sm, stm_offset, STEPPER_STEP_PIN, 6e6);
+    if( programOffset < 0 ) {
+        programOffset = pio_add_program(pio, &stepper_program);
+    }
+    stepper_program_init(pio, pio_sm, programOffset, stepPin, directionPin,
+                         stepper_STEPDELAY * 1e9f / STEPPER_PULSE_NS);
+
+    // command ring -> state machine TX FIFO, paced by the FIFO's DREQ
+    dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config dc = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&dc, DMA_SIZE_32);
+    channel_config_set_read_increment(&dc, true);
+    channel_config_set_write_increment(&dc, false);
+    channel_config_set_ring(&dc, false, STEPPER_RING_BITS + 2);
+    channel_config_set_dreq(&dc, pio_get_dreq(pio, pio_sm, true));
+    dma_channel_configure(dma_channel, &dc, &pio->txf[pio_sm], commandRing, 0, false);
+
+    // with no timing the drive would never step; SanityCheck.h catches the
+    // driver limits, but not what the clock divider can reach
+    if( !configureTiming(STEPPER_PULSE_NS, STEPPER_SPACE_NS, STEPPER_MAX_STEP_RATE_HZ) ) {
+        panic("StepperDrive: STEPPER_PULSE_NS, STEPPER_SPACE_NS or the direction timing cannot be generated");
+    }
+    applyTiming();
+
     #ifdef INVERT_STEP_PIN
-        gpio_set_outover(STEPPER_STEP_PIN, GPIO_OVERRIDE_INVERT);
+        gpio_set_outover(stepPin, GPIO_OVERRIDE_INVERT);
     #endif
     #ifdef INVERT_DIRECTION_PIN
-        gpio_set_outover(STEPPER_DIRECTION_PIN, GPIO_OVERRIDE_INVERT);
+        gpio_set_outover(directionPin, GPIO_OVERRIDE_INVERT);
     #endif
     #ifdef INVERT_ENABLE_PIN
-        gpio_set_outover(STEPPER_ENABLE_PIN, GPIO_OVERRIDE_INVERT);
+        gpio_set_outover(enablePin, GPIO_OVERRIDE_INVERT);
     #endif
     #ifdef INVERT_ALARM_PIN
-        gpio_set_inover(STEPPER_ALARM_PIN, GPIO_OVERRIDE_INVERT);
+        gpio_set_inover(alarmPin, GPIO_OVERRIDE_INVERT);
     #endif
 
     setEnabled(true);
 }
 
+static uint32_t nsToCycles(uint32_t ns, uint64_t frequency)
+{
+    return (uint32_t)(((uint64_t)ns * frequency + 999999999) / 1000000000);
+}
+
+//
+// Work out the timing for a step pulse width, a minimum low time between
+// pulses and a step rate ceiling.  The state machine clock is chosen so its
+// fixed STEPDELAY cycles give the pulse width; the space and rate limits
+// become a minimum spacing added after each step.  Returns false if the
+// request breaks the driver's limits or cannot be generated.
+//
+bool StepperDrive :: planTiming(uint32_t pulseNs, uint32_t spaceNs, uint32_t maxStepRateHz, STEPPER_TIMING *timing)
+{
+    if( pulseNs < STEPPER_DRIVER_MIN_PULSE_NS
+        || spaceNs < STEPPER_DRIVER_MIN_SPACE_NS
+        || maxStepRateHz == 0
+        || maxStepRateHz > STEPPER_DRIVER_MAX_STEP_RATE_HZ ) {
+        return false;
+    }
 
+    uint64_t systemHz = clock_get_hz(clk_sys);
+    uint64_t frequency = (uint64_t)stepper_STEPDELAY * 1000000000 / pulseNs;
+    if( frequency > systemHz || frequency * 65536 < systemHz ) {
+        // outside the range of the state machine clock divider
+        return false;
+    }
 
+    uint32_t ticks = (uint32_t)(frequency * STEPPER_CYCLE_US / 1000000);
+    if( ticks == 0 || ticks > UINT32_MAX / (STEPPER_MAX_SPREAD_TICKS * 65536) ) {
+        // the burst spacing math would overflow
+        return false;
+    }
 
+    uint32_t hold = nsToCycles(STEPPER_DIRECTION_HOLD_NS, frequency);
+    uint32_t setup = nsToCycles(STEPPER_DIRECTION_SETUP_NS, frequency);
+    if( hold > STEPPER_MAX_DIRECTION_CYCLES || setup > STEPPER_MAX_DIRECTION_CYCLES ) {
+        return false;
+    }
 
+    uint32_t spacing = 0;
+    uint32_t spaceCycles = nsToCycles(spaceNs, frequency);
+    if( spaceCycles > STEPPER_LOW_CYCLES ) {
+        spacing = spaceCycles - STEPPER_LOW_CYCLES;
+    }
+    uint32_t periodCycles = (uint32_t)((frequency + maxStepRateHz - 1) / maxStepRateHz);
+    if( periodCycles > stepper_STEP_OVERHEAD + spacing ) {
+        spacing = periodCycles - stepper_STEP_OVERHEAD;
+    }
 
+    timing->tickCycles = ticks;
+    timing->minSpacing = spacing;
+    timing->directionHoldCycles = hold;
+    timing->directionSetupCycles = setup;
+    timing->maxStepRate = std::min(maxStepRateHz, (uint32_t)(frequency / (stepper_STEP_OVERHEAD + spacing)));
+    timing->clockDivider = (float)systemHz / (float)frequency;
+    return true;
+}
+
+//
+// Change the step pulse width, spacing and rate ceiling.  The new timing is
+// checked here and applied by the motion loop the next time the drive is
+// idle or disabled, so steps already queued keep the timing they were
+// planned with; a change not yet applied is replaced.  Returns false, and
+// changes nothing, if the timing cannot be generated.  Call on the core
+// running the motion loop (CoreProxy sends the change across); the motion
+// loop may interrupt the call, but never sees a half-written change.
+//
+bool StepperDrive :: configureTiming(uint32_t pulseNs, uint32_t spaceNs, uint32_t maxStepRateHz)
+{
+    STEPPER_TIMING timing;
+    if( !planTiming(pulseNs, spaceNs, maxStepRateHz, &timing) ) {
+        return false;
+    }
+
+    timingChanged = false;
+    __dmb();
+    pendingTiming = timing;
+    __dmb();
+    timingChanged = true;
+    return true;
+}
+
+void StepperDrive :: applyTiming(void)
+{
+    tickCycles = pendingTiming.tickCycles;
+    minSpacing = pendingTiming.minSpacing;
+    directionHoldCycles = pendingTiming.directionHoldCycles;
+    directionSetupCycles = pendingTiming.directionSetupCycles;
+    maxStepRate = pendingTiming.maxStepRate;
+    pio_sm_set_clkdiv(pio, pio_sm, pendingTiming.clockDivider);
+    timingChanged = false;
+}
@@ -38,8 +38,47 @@
 #include "hardware/gpio.h"
 #include "Configuration.h"
 #include "hardware/pio.h"
+#include "hardware/dma.h"
 #include "stepper.pio.h"
 
+// Most steps output in one command
+#define STEPPER_MAX_BURST 32
+
+// Longest window, in motion ticks, that a burst of steps is spread over.
+// Caps the added latency at low speeds.
+#define STEPPER_MAX_SPREAD_TICKS 32
+
+// Size of the command ring, in words, as a power of two.  DMA wraps its read
+// address on this boundary.
+#define STEPPER_RING_BITS 6
+#define STEPPER_RING_SIZE (1 << STEPPER_RING_BITS)
+
+// How far ahead of the state machine the motion ISR may queue, in ticks
+#define STEPPER_QUEUE_AHEAD_TICKS 4
+
+// Longest direction setup or hold, in state machine cycles; the fields of a
+// direction command are 15 bits wide
+#define STEPPER_MAX_DIRECTION_CYCLES ((1 << 15) - 1)
+
+// Backlash take-up allowance earned per motion tick, in 1/65536 steps
+#define STEPPER_BACKLASH_CREDIT_PER_TICK ((uint32_t)((uint64_t)STEPPER_BACKLASH_RATE_HZ * STEPPER_CYCLE_US * 65536 / 1000000))
+
+// Low time of a step, in state machine cycles, before any added spacing
+#define STEPPER_LOW_CYCLES (stepper_STEP_OVERHEAD - stepper_STEPDELAY)
+
+//
+// Step timing worked out from a pulse width, spacing and rate ceiling, ready
+// to be applied to the state machine
+//
+typedef struct STEPPER_TIMING
+{
+    uint32_t tickCycles;
+    uint32_t minSpacing;
+    uint32_t directionHoldCycles;
+    uint32_t directionSetupCycles;
+    uint32_t maxStepRate;
+    float clockDivider;
+} STEPPER_TIMING;
 
 class StepperDrive
 {
@@ -56,18 +95,95 @@ private:
 
     bool previousDir;
 
+    //
+    // Backlash take-up.  Take-up steps move the motor but not the logical
+    // position, so they never count against the step backlog.
+    //
+    uint32_t backlashSteps;
+    uint32_t backlashRemaining;
+    uint32_t backlashCredit;
+
+    //
+    // Motion ticks since the last command was sent to the state machine
+    //
+    uint32_t ticksSinceCommand;
+
+    //
+    // New timing from configureTiming, waiting for the drive to go idle
+    //
+    STEPPER_TIMING pendingTiming;
+    volatile bool timingChanged;
+
+    void applyTiming(void);
+
+    //
+    // Step timing, in state machine cycles, set by applyTiming
+    //
+    uint32_t tickCycles;
+    uint32_t minSpacing;
+    uint32_t directionHoldCycles;
+    uint32_t directionSetupCycles;
+
+    //
+    // Fastest sustained step rate the timing allows, in steps per second
+    //
+    uint32_t maxStepRate;
+
+    //
+    // 65536 / n, so a burst can be spread over its window without dividing
+    //
+    uint32_t burstReciprocal[STEPPER_MAX_BURST + 1];
+
     //
     // Is the drive enabled?
     //
     bool enabled;
 
+    //
+    // Commands waiting for the state machine.  The ISR appends at ringHead;
+    // DMA feeds everything up to ringCommitted into the TX FIFO.  Both
+    // indices are free-running.
+    //
+    uint32_t commandRing[STEPPER_RING_SIZE] __attribute__((aligned(STEPPER_RING_SIZE * sizeof(uint32_t))));
+    uint32_t ringHead;
+    uint32_t ringCommitted;
+
+    //
+    // State machine cycles queued that have not yet played out
+    //
+    uint32_t queuedCycles;
+
+    //
+    // Pins for this axis
+    //
+    uint stepPin;
+    uint directionPin;
+    uint enablePin;
+    uint alarmPin;
+
     PIO pio;
     uint32_t pio_sm;
+    uint dma_channel;
+
+    //
+    // Every axis runs the same stepper program on its own state machine;
+    // it is loaded once, by the first axis initialized
+    //
+    static int programOffset;
+
+    uint32_t ringFree(void);
+    void queue(uint32_t command);
+    void kick(void);
 
 public:
     StepperDrive();
+    StepperDrive(uint stepPin, uint directionPin, uint enablePin, uint alarmPin);
     void initHardware(void);
 
+    static bool planTiming(uint32_t pulseNs, uint32_t spaceNs, uint32_t maxStepRateHz, STEPPER_TIMING *timing);
+    bool configureTiming(uint32_t pulseNs, uint32_t spaceNs, uint32_t maxStepRateHz);
+    uint32_t getMaxStepRate(void);
+
     void setDesiredPosition(int32_t steps);
     void incrementCurrentPosition(int32_t increment);
     void setCurrentPosition(int32_t position);
@@ -78,7 +194,7 @@ public:
 
     bool isAlarm();
 
-    void move(void);
+    void move(uint32_t ticks);
     bool busy(void);
 };
 
@@ -97,6 +213,11 @@ inline void StepperDrive :: setCurrentPosition(int32_t position)
     this->currentPosition = position;
 }
 
+inline uint32_t StepperDrive :: getMaxStepRate(void)
+{
+    return maxStepRate;
+}
+
 inline bool StepperDrive :: checkStepBacklog()
 {
     if( abs(this->desiredPosition - this->currentPosition) > MAX_BUFFERED_STEPS ) {
@@ -109,42 +230,122 @@ inline bool StepperDrive :: checkStepBacklog()
 inline void StepperDrive :: setEnabled(bool enabled)
 {
     this->enabled = enabled;
-    gpio_put(STEPPER_ENABLE_PIN, enabled);
+    gpio_put(enablePin, enabled);
 }
 
 inline bool StepperDrive :: isAlarm()
 {
 #ifdef USE_ALARM_PIN
-    return gpio_get(STEPPER_ALARM_PIN);
+    return gpio_get(alarmPin);
 #else
     return false;
 #endif
 }
 
+//
+// Each axis runs on its own state machine, which raises its own IRQ flag
+// (IRQ 0 relative to the state machine) while idle
+//
 inline bool StepperDrive :: busy(void) {
-    return !pio_interrupt_get(pio, 0);
+    return ringHead != ringCommitted || dma_channel_is_busy(dma_channel) || !pio_interrupt_get(pio, pio_sm);
 }
 
-inline void StepperDrive :: move(void)
+inline uint32_t StepperDrive :: ringFree(void)
+{
+    uint32_t consumed = ringCommitted - dma_channel_hw_addr(dma_channel)->transfer_count;
+    return STEPPER_RING_SIZE - (ringHead - consumed);
+}
+
+inline void StepperDrive :: queue(uint32_t command)
+{
+    commandRing[ringHead & (STEPPER_RING_SIZE - 1)] = command;
+    ringHead++;
+}
+
+//
+// Hand any newly queued commands to DMA.  The read address carries on from
+// the end of the previous transfer, wrapping on the ring, so only the count
+// needs to be written.
+//
+inline void StepperDrive :: kick(void)
 {
+    if( ringHead != ringCommitted && !dma_channel_is_busy(dma_channel) ) {
+        dma_channel_set_trans_count(dma_channel, ringHead - ringCommitted, true);
+        ringCommitted = ringHead;
+    }
+}
+
+//
+// Queue the steps that have built up since the last command as one burst,
+// spaced evenly over the ticks it took them to build up, so the step rate
+// follows spindle velocity instead of arriving back-to-back.  Never blocks;
+// if the state machine is far enough behind, the steps wait for a later tick.
+// ticks is the number of motion ticks since the previous call.
+//
+// After a reversal, backlash take-up steps ride along in the same bursts as
+// the credit for them builds up.  Synchronized steps always go first.
+//
+inline void StepperDrive :: move(uint32_t ticks)
+{
+    // new timing only ever starts between commands, with nothing in flight
+    if( timingChanged && (!enabled || !busy()) ) {
+        applyTiming();
+    }
+
+    ticksSinceCommand = std::min(ticksSinceCommand + ticks, (uint32_t)STEPPER_MAX_SPREAD_TICKS);
+    uint32_t elapsed = ticks * tickCycles;
+    queuedCycles = queuedCycles > elapsed ? queuedCycles - elapsed : 0;
+
+    if(backlashRemaining != 0) {
+        backlashCredit = std::min(backlashCredit + ticks * STEPPER_BACKLASH_CREDIT_PER_TICK,
+                                  (uint32_t)STEPPER_MAX_BURST << 16);
+    }
+
     if(enabled) {
         int32_t delta = desiredPosition - currentPosition;
-        uint32_t stepsToTake = std::min(abs(delta),32);
-        bool dir = delta > 0;
+        uint32_t stepsToTake = std::min(abs(delta),STEPPER_MAX_BURST);
+        bool dir = stepsToTake != 0 ? delta > 0 : previousDir;
         
-        if(stepsToTake != 0 && !busy()) {
+        if((stepsToTake != 0 || backlashCredit >= 1 << 16)
+           && queuedCycles < STEPPER_QUEUE_AHEAD_TICKS * tickCycles
+           && ringFree() >= 2) {
             if(dir != previousDir){
-                gpio_put(STEPPER_DIRECTION_PIN, dir);
+                // the state machine holds, switches and sets up the
+                // direction ahead of the burst that follows
+                queue(1
+                      | (directionHoldCycles << 1)
+                      | ((uint32_t)dir << 16)
+                      | (directionSetupCycles << 17));
+                queuedCycles += stepper_COMMAND_OVERHEAD + directionHoldCycles + directionSetupCycles;
                 previousDir = dir;
-                busy_wait_us(STEPPER_CYCLE_US); 
+
+                // the slack is now on the other side; reversing again part
+                // way through only has to recover what was taken up so far
+                backlashRemaining = backlashSteps - backlashRemaining;
+                backlashCredit = 0;
+            }
+
+            uint32_t takeUp = std::min({backlashRemaining, backlashCredit >> 16, STEPPER_MAX_BURST - stepsToTake});
+            backlashRemaining -= takeUp;
+            backlashCredit = backlashRemaining != 0 ? backlashCredit - (takeUp << 16) : 0;
+
+            uint32_t burst = stepsToTake + takeUp;
+            if(burst != 0) {
+                uint32_t period = (ticksSinceCommand * tickCycles * burstReciprocal[burst]) >> 16;
+                uint32_t spacing = period > stepper_STEP_OVERHEAD + minSpacing ? period - stepper_STEP_OVERHEAD : minSpacing;
+
+                queue(((burst - 1) << 1) | (spacing << 7));
+                queuedCycles += stepper_COMMAND_OVERHEAD + burst * (stepper_STEP_OVERHEAD + spacing);
+                currentPosition += stepsToTake * (dir ? 1 : -1);
+                ticksSinceCommand = 0;
             }
-            pio_sm_put_blocking(pio, pio_sm, (uint32_t)0xFFFFFFFF >> (uint32_t)(32-stepsToTake));
-            currentPosition += stepsToTake * (dir ? 1 : -1);
         }
     } else {
         // not enabled; just keep current position in sync
         this->currentPosition = this->desiredPosition;
     }
+
+    kick();
 }
 
 #endif // __STEPPERDRIVE_H
@@ -0,0 +1,180 @@
+// Pico Electronic Leadscrew
+// https://github.com/funkenjaeger/pico-els
+//
+// MIT License
+//
+// Copyright (c) 2025 Evan Dudzik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include "SyncFollower.h"
+
+// Neither velocity can exceed FOLLOWER_MAX_STEPS_PER_TICK, so the square of a
+// closing speed in the braking tests always fits in 64 bits
+static_assert(2 * FOLLOWER_MAX_STEPS_PER_TICK * FOLLOWER_ONE <= INT64_MAX / (2 * FOLLOWER_MAX_STEPS_PER_TICK * FOLLOWER_ONE),
+    "closing speed squared can overflow");
+
+SyncFollower :: SyncFollower(int32_t acceleration)
+{
+    this->acceleration = acceleration;
+    position = 0;
+    velocity = 0;
+    targetVelocity = 0;
+    previousTarget = 0;
+    maxVelocity = FOLLOWER_MAX_STEPS_PER_TICK << FOLLOWER_SHIFT;
+    locked = true;
+    limited = false;
+    lowerLimit = 0;
+    upperLimit = 0;
+}
+
+//
+// Start a new engagement from the current commanded position.  From rest,
+// the carriage is assumed stopped (e.g. the drive was just enabled);
+// otherwise it keeps the velocity it had.  maxStepRate is the drive's
+// ceiling in steps per second; catching up never asks for more than it, less
+// the headroom.
+//
+void SyncFollower :: engage(bool fromRest, uint32_t maxStepRate)
+{
+    int64_t ceiling = ((int64_t)maxStepRate * STEPPER_CYCLE_US << FOLLOWER_SHIFT) / 1000000;
+    ceiling -= ceiling >> FOLLOWER_RATE_HEADROOM_SHIFT;
+    maxVelocity = (int32_t)std::min(ceiling, (int64_t)FOLLOWER_MAX_STEPS_PER_TICK << FOLLOWER_SHIFT);
+
+    if( fromRest ) {
+        velocity = 0;
+    }
+    locked = false;
+}
+
+//
+// Keep the carriage within [lower, upper] steps.  A limit the carriage is
+// already past holds it where it is until the target comes back.
+//
+void SyncFollower :: setLimits(int32_t lower, int32_t upper)
+{
+    lowerLimit = std::min((int64_t)lower << FOLLOWER_SHIFT, position);
+    upperLimit = std::max((int64_t)upper << FOLLOWER_SHIFT, position);
+    limited = true;
+}
+
+//
+// Release the limits; if the carriage was parked, it ramps back into sync
+//
+void SyncFollower :: clearLimits(void)
+{
+    limited = false;
+}
+
+//
+// Is the carriage, moving as it is now, within braking distance of the limit
+// ahead of it, allowing for the ticks until the next update?
+//
+bool SyncFollower :: nearLimit(uint32_t ticks)
+{
+    if( velocity == 0 ) {
+        return false;
+    }
+
+    int64_t speed = velocity < 0 ? -(int64_t)velocity : velocity;
+    int64_t distance = (velocity > 0 ? upperLimit - position : position - lowerLimit) - speed * ticks;
+    if( distance <= 0 ) {
+        return true;
+    }
+
+    return speed * speed / (2 * (int64_t)acceleration) >= distance;
+}
+
+//
+// Run the ramp for each elapsed tick.  The target is only known at the end,
+// so it is walked there at the filtered target velocity.
+//
+int32_t SyncFollower :: track(int32_t target, uint32_t ticks)
+{
+    ticks = std::min(ticks, (uint32_t)FOLLOWER_MAX_CATCHUP_TICKS);
+
+    int64_t end = (int64_t)target << FOLLOWER_SHIFT;
+    int64_t goal = end - (int64_t)targetVelocity * (ticks - 1);
+    int32_t limit = maxVelocity;
+
+    // a target the drive cannot keep up with can never be caught, and
+    // chasing it only builds a step backlog; stop and wait for it to slow
+    bool unreachable = targetVelocity > limit || targetVelocity < -limit;
+
+    for( ; ticks > 0; ticks--, goal += targetVelocity ) {
+        // a target beyond a soft limit is treated as standing still on it
+        int64_t aim = goal;
+        int32_t aimVelocity = targetVelocity;
+        bool held = false;
+        if( unreachable ) {
+            aim = position;
+            aimVelocity = 0;
+            held = true;
+        } else if( limited && (goal > upperLimit || goal < lowerLimit) ) {
+            aim = std::clamp(goal, lowerLimit, upperLimit);
+            aimVelocity = 0;
+            held = true;
+        }
+
+        int64_t error = aim - position;
+
+        // speed at which the carriage is closing on the target
+        int64_t closing = (int64_t)velocity - aimVelocity;
+        int64_t distance = error < 0 ? -error : error;
+        int64_t speed = error < 0 ? -closing : closing;
+
+        if( distance <= FOLLOWER_LOCK_ERROR && (closing < 0 ? -closing : closing) <= FOLLOWER_LOCK_VELOCITY ) {
+            if( held ) {
+                // parked on the limit, or waiting for the target to slow
+                position = aim;
+                velocity = 0;
+                continue;
+            }
+            if( !limited || !nearLimit(ticks) ) {
+                locked = true;
+                position = end;
+                velocity = targetVelocity;
+                return target;
+            }
+        }
+
+        // brake once the stopping distance at the current closing speed reaches
+        // the remaining error (v^2 / 2a >= d), otherwise keep accelerating
+        // toward it.  Compared uncapped, so the braking point is right however
+        // far away the target is.
+        bool brake = speed > 0 && speed * speed / (2 * (int64_t)acceleration) >= distance;
+        int32_t dv = brake ? -acceleration : acceleration;
+
+        velocity = std::clamp(velocity + (error < 0 ? -dv : dv), -limit, limit);
+
+        if( limited ) {
+            // never faster than the carriage can stop from before the limit
+            // (v = sqrt(2ad)); this, and the clamp, land it exactly on it
+            int64_t room = velocity > 0 ? upperLimit - position : position - lowerLimit;
+            int32_t stop = room > 0 ? (int32_t)std::min(sqrtf(2.0f * acceleration * (float)room), (float)limit) : 0;
+            velocity = std::clamp(velocity, -stop, stop);
+            position = std::clamp(position + velocity, lowerLimit, upperLimit);
+        } else {
+            position += velocity;
+        }
+    }
+
+    return (int32_t)(position >> FOLLOWER_SHIFT);
+}
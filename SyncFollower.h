@@ -0,0 +1,149 @@
+// Pico Electronic Leadscrew
+// https://github.com/funkenjaeger/pico-els
+//
+// MIT License
+//
+// Copyright (c) 2025 Evan Dudzik
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __SYNCFOLLOWER_H
+#define __SYNCFOLLOWER_H
+
+#include <cstdint>
+#include <algorithm>
+#include "Configuration.h"
+
+// Follower positions and velocities are fixed point, in steps and steps per
+// motion tick, with this many fractional bits
+#define FOLLOWER_SHIFT 24
+#define FOLLOWER_ONE ((int64_t)1 << FOLLOWER_SHIFT)
+
+// Largest velocity the follower will command, in steps per tick; matches the
+// most StepperDrive::move will output in one tick
+#define FOLLOWER_MAX_STEPS_PER_TICK 32
+
+// Share of the drive's step rate ceiling kept in reserve while catching up,
+// as a power of two; the follower never commands more than the rest
+#define FOLLOWER_RATE_HEADROOM_SHIFT 4
+
+// Time constant of the target velocity filter, as a power of two in ticks
+#define FOLLOWER_VELOCITY_FILTER 8
+
+// Most ticks simulated in one update when the motion loop has been idle
+#define FOLLOWER_MAX_CATCHUP_TICKS 256
+
+// Sync is considered locked once the error is within one step and the
+// relative velocity within 1/256 step per tick
+#define FOLLOWER_LOCK_ERROR FOLLOWER_ONE
+#define FOLLOWER_LOCK_VELOCITY (FOLLOWER_ONE / 256)
+
+// SYNC_ACCELERATION converted to fixed-point steps per tick squared
+#define FOLLOWER_ACCELERATION ((int32_t)((uint64_t)SYNC_ACCELERATION * STEPPER_CYCLE_US * STEPPER_CYCLE_US \
+                                         * FOLLOWER_ONE / 1000000000000ULL))
+
+static_assert(FOLLOWER_ACCELERATION > 0, "SYNC_ACCELERATION is too small to represent per motion tick");
+
+//
+// Sits between the ratio engine and the stepper drive.  While locked it
+// passes the synchronized target straight through.  When engaged, it
+// brings the carriage up to the target velocity under a bounded
+// acceleration, then closes the phase error left over from the ramp and
+// locks again.
+//
+// With soft limits set, it also lets go of the target in time to brake onto
+// a limit under the same acceleration, parks exactly on it, and picks the
+// target up again once it comes back inside.
+//
+class SyncFollower
+{
+private:
+    //
+    // Commanded position and velocity, fixed point
+    //
+    int64_t position;
+    int32_t velocity;
+
+    //
+    // Filtered velocity of the target, fixed point
+    //
+    int32_t targetVelocity;
+    int32_t previousTarget;
+
+    int32_t acceleration;
+
+    //
+    // Fastest the follower may drive the carriage while catching up, fixed
+    // point; set from the drive's step rate ceiling on each engagement
+    //
+    int32_t maxVelocity;
+
+    bool locked;
+
+    //
+    // Soft limits, fixed point
+    //
+    bool limited;
+    int64_t lowerLimit;
+    int64_t upperLimit;
+
+    int32_t track(int32_t target, uint32_t ticks);
+    bool nearLimit(uint32_t ticks);
+
+public:
+    SyncFollower(int32_t acceleration);
+
+    void engage(bool fromRest, uint32_t maxStepRate);
+
+    void setLimits(int32_t lower, int32_t upper);
+    void clearLimits(void);
+
+    int32_t update(int32_t target, uint32_t ticks);
+};
+
+//
+// Advance by ticks motion ticks (at least one) to the new target
+//
+inline int32_t SyncFollower :: update(int32_t target, uint32_t ticks)
+{
+    // a jump in the target (not a velocity) must not upset the filter
+    int32_t limit = FOLLOWER_MAX_STEPS_PER_TICK << FOLLOWER_SHIFT;
+    int64_t step = (int64_t)(target - previousTarget) << FOLLOWER_SHIFT;
+    if( ticks > 1 ) {
+        step /= ticks;
+    }
+    previousTarget = target;
+
+    int64_t rate = std::clamp(step, (int64_t)-limit, (int64_t)limit);
+    int64_t weight = std::min(ticks, (uint32_t)1 << FOLLOWER_VELOCITY_FILTER);
+    targetVelocity += (int32_t)(((rate - targetVelocity) * weight) >> FOLLOWER_VELOCITY_FILTER);
+
+    if( locked ) {
+        position = (int64_t)target << FOLLOWER_SHIFT;
+        velocity = targetVelocity;
+        if( !limited || !nearLimit(ticks) ) {
+            return target;
+        }
+        locked = false;
+    }
+
+    return track(target, ticks);
+}
+
+#endif // __SYNCFOLLOWER_H
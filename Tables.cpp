@@ -28,8 +28,17 @@
 // SOFTWARE.
 
 
+#include <algorithm>
 #include "Tables.h"
 
+//
+// The fraction macros below describe each ratio in its natural units; this
+// reduces it to lowest terms at compile time.  Values that would not fit the
+// 32-bit table fields fail feed_table_is_exact() below.
+//
+#define REDUCED_FRACTION(num, den) \
+    .numerator = fraction_term((num) / fraction_gcd((num), (den))), \
+    .denominator = fraction_term((den) / fraction_gcd((num), (den)))
 
 //
 // INCH THREAD DEFINITIONS
@@ -45,9 +54,9 @@
 #define TPI_NUMERATOR(tpi) (uint64_t(254*100*STEPPER_RESOLUTION*STEPPER_MICROSTEPS))
 #define TPI_DENOMINATOR(tpi) (uint64_t(tpi*ENCODER_RESOLUTION*LEADSCREW_HMM))
 #endif
-#define TPI_FRACTION(tpi) .numerator = TPI_NUMERATOR(tpi), .denominator = TPI_DENOMINATOR(tpi)
+#define TPI_FRACTION(tpi) REDUCED_FRACTION(TPI_NUMERATOR(tpi), TPI_DENOMINATOR(tpi))
 
-const FEED_THREAD inch_thread_table[] =
+constexpr FEED_THREAD inch_thread_table[] =
 {
  { .display = {BLANK, BLANK, BLANK, EIGHT}, .leds = LED_THREAD | LED_TPI, TPI_FRACTION(80) },
  { .display = {BLANK, BLANK, BLANK, NINE},  .leds = LED_THREAD | LED_TPI, TPI_FRACTION(90) },
@@ -93,9 +102,9 @@ const FEED_THREAD inch_thread_table[] =
 #define THOU_IN_NUMERATOR(thou) ((uint64_t)thou*254*STEPPER_RESOLUTION_FEED*STEPPER_MICROSTEPS_FEED)
 #define THOU_IN_DENOMINATOR(thou) ((uint64_t)ENCODER_RESOLUTION*100*LEADSCREW_HMM)
 #endif
-#define THOU_IN_FRACTION(thou) .numerator = THOU_IN_NUMERATOR(thou), .denominator = THOU_IN_DENOMINATOR(thou)
+#define THOU_IN_FRACTION(thou) REDUCED_FRACTION(THOU_IN_NUMERATOR(thou), THOU_IN_DENOMINATOR(thou))
 
-const FEED_THREAD inch_feed_table[] =
+constexpr FEED_THREAD inch_feed_table[] =
 {
  { .display = {POINT, ZERO, ZERO,  ONE},    .leds = LED_FEED | LED_INCH, THOU_IN_FRACTION(1) },
  { .display = {POINT, ZERO, ZERO,  TWO},    .leds = LED_FEED | LED_INCH, THOU_IN_FRACTION(2) },
@@ -137,9 +146,9 @@ const FEED_THREAD inch_feed_table[] =
 #define HMM_NUMERATOR(hmm) ((uint64_t)hmm*STEPPER_RESOLUTION*STEPPER_MICROSTEPS)
 #define HMM_DENOMINATOR(hmm) ((uint64_t)ENCODER_RESOLUTION*LEADSCREW_HMM)
 #endif
-#define HMM_FRACTION(hmm) .numerator = HMM_NUMERATOR(hmm), .denominator = HMM_DENOMINATOR(hmm)
+#define HMM_FRACTION(hmm) REDUCED_FRACTION(HMM_NUMERATOR(hmm), HMM_DENOMINATOR(hmm))
 
-const FEED_THREAD metric_thread_table[] =
+constexpr FEED_THREAD metric_thread_table[] =
 {
  { .display = {BLANK, POINT,         TWO,   BLANK}, .leds = LED_THREAD | LED_MM, HMM_FRACTION(20) },
  { .display = {BLANK, POINT,         TWO,   FIVE},  .leds = LED_THREAD | LED_MM, HMM_FRACTION(25) },
@@ -183,9 +192,9 @@ const FEED_THREAD metric_thread_table[] =
 #define HMM_NUMERATOR_FEED(hmm) ((uint64_t)hmm*STEPPER_RESOLUTION_FEED*STEPPER_MICROSTEPS_FEED)
 #define HMM_DENOMINATOR_FEED(hmm) ((uint64_t)ENCODER_RESOLUTION*LEADSCREW_HMM)
 #endif
-#define HMM_FRACTION_FEED(hmm) .numerator = HMM_NUMERATOR_FEED(hmm), .denominator = HMM_DENOMINATOR_FEED(hmm)
+#define HMM_FRACTION_FEED(hmm) REDUCED_FRACTION(HMM_NUMERATOR_FEED(hmm), HMM_DENOMINATOR_FEED(hmm))
 
-const FEED_THREAD metric_feed_table[] =
+constexpr FEED_THREAD metric_feed_table[] =
 {
  { .display = {BLANK, POINT,       ZERO,  TWO},   .leds = LED_FEED | LED_MM, HMM_FRACTION_FEED(2) },
  { .display = {BLANK, POINT,       ZERO,  FIVE},  .leds = LED_FEED | LED_MM, HMM_FRACTION_FEED(5) },
@@ -210,8 +219,31 @@ const FEED_THREAD metric_feed_table[] =
  { .display = {BLANK, ONE | POINT, ZERO,  ZERO},  .leds = LED_FEED | LED_MM, HMM_FRACTION_FEED(100) },
 };
 
+// Largest drive ratio the ratio engine can be given
+#ifdef USE_GEARBOX
+constexpr double MAX_DRIVE_RATIO = std::max({GEARBOX_DRIVE_RATIO_A, GEARBOX_DRIVE_RATIO_B, GEARBOX_DRIVE_RATIO_C})
+                                 * std::max(FEED_GEAR_RATIO, THREAD_GEAR_RATIO);
+#else
+constexpr double MAX_DRIVE_RATIO = 1.0;
+#endif
 
+static_assert(feed_table_is_exact(inch_thread_table, sizeof(inch_thread_table)/sizeof(inch_thread_table[0])),
+    "inch thread table does not reduce to exact 32-bit ratios");
+static_assert(feed_table_is_exact(inch_feed_table, sizeof(inch_feed_table)/sizeof(inch_feed_table[0])),
+    "inch feed table does not reduce to exact 32-bit ratios");
+static_assert(feed_table_is_exact(metric_thread_table, sizeof(metric_thread_table)/sizeof(metric_thread_table[0])),
+    "metric thread table does not reduce to exact 32-bit ratios");
+static_assert(feed_table_is_exact(metric_feed_table, sizeof(metric_feed_table)/sizeof(metric_feed_table[0])),
+    "metric feed table does not reduce to exact 32-bit ratios");
 
+static_assert(feed_table_fits_engine(inch_thread_table, sizeof(inch_thread_table)/sizeof(inch_thread_table[0]), MAX_DRIVE_RATIO),
+    "inch thread table can overflow the ratio engine at ENCODER_MAX_COUNT_RATE");
+static_assert(feed_table_fits_engine(inch_feed_table, sizeof(inch_feed_table)/sizeof(inch_feed_table[0]), MAX_DRIVE_RATIO),
+    "inch feed table can overflow the ratio engine at ENCODER_MAX_COUNT_RATE");
+static_assert(feed_table_fits_engine(metric_thread_table, sizeof(metric_thread_table)/sizeof(metric_thread_table[0]), MAX_DRIVE_RATIO),
+    "metric thread table can overflow the ratio engine at ENCODER_MAX_COUNT_RATE");
+static_assert(feed_table_fits_engine(metric_feed_table, sizeof(metric_feed_table)/sizeof(metric_feed_table[0]), MAX_DRIVE_RATIO),
+    "metric feed table can overflow the ratio engine at ENCODER_MAX_COUNT_RATE");
 
 
 FeedTable::FeedTable(const FEED_THREAD *table, uint16_t numRows, uint16_t defaultSelection)
@@ -31,17 +31,67 @@
 #define __TABLES_H
 
 #include <cstdint>
+#include <cstddef>
 #include "Configuration.h"
 #include "ControlPanel.h"
+#include "RatioEngine.h"
 
+//
+// Feed ratio in steps per encoder count, stored as an irreducible fraction
+// so that it can be handed to the ratio engine without loss
+//
 typedef struct FEED_THREAD
 {
     uint16_t display[4];
     union LED_REG leds;
-    uint64_t numerator;
-    uint64_t denominator;
+    uint32_t numerator;
+    uint32_t denominator;
 } FEED_THREAD;
 
+constexpr uint64_t fraction_gcd(uint64_t a, uint64_t b)
+{
+    return b == 0 ? a : fraction_gcd(b, a % b);
+}
+
+// Narrow a reduced fraction term to the table width; a term that does not
+// fit becomes zero, which feed_table_is_exact() rejects
+constexpr uint32_t fraction_term(uint64_t value)
+{
+    return value <= UINT32_MAX ? uint32_t(value) : 0;
+}
+
+//
+// Compile-time check that every row of a feed table is an exact, reduced
+// fraction that stays within 32 bits once scaled by any drive ratio the
+// ratio engine will accept, so RatioEngine::makeRatio never has to round
+//
+constexpr bool feed_table_is_exact(const FEED_THREAD *table, size_t numRows)
+{
+    for( size_t i = 0; i < numRows; i++ ) {
+        const FEED_THREAD &row = table[i];
+        if( row.numerator == 0 || row.denominator == 0 ) return false;
+        if( fraction_gcd(row.numerator, row.denominator) != 1 ) return false;
+        if( row.numerator > UINT32_MAX / RATIO_MAX_FLOAT_DENOMINATOR ) return false;
+        if( row.denominator > UINT32_MAX / RATIO_MAX_FLOAT_DENOMINATOR ) return false;
+    }
+    return true;
+}
+
+//
+// Compile-time check that a feed table cannot overflow the ratio engine's
+// 32-bit step arithmetic: the most counts one pass can see, times the
+// largest steps per count any row gives at the largest drive ratio, must
+// fit in an int32_t
+//
+constexpr bool feed_table_fits_engine(const FEED_THREAD *table, size_t numRows, double maxDriveRatio)
+{
+    for( size_t i = 0; i < numRows; i++ ) {
+        double stepsPerCount = (double)table[i].numerator / table[i].denominator * maxDriveRatio;
+        if( stepsPerCount * RATIO_MAX_COUNTS_PER_PASS >= (double)INT32_MAX ) return false;
+    }
+    return true;
+}
+
 
 
 class FeedTable
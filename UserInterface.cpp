@@ -30,6 +30,7 @@
 
 #include "UserInterface.h"
 #include <stdio.h>
+#include <algorithm>
 
 const MESSAGE STARTUP_MESSAGE_2 =
 {
@@ -72,6 +73,33 @@ const MESSAGE BACKLOG_PANIC_MESSAGE_2 =
 };
 
 
+const MESSAGE FEED_REFUSED_MESSAGE =
+{
+ .message = { LETTER_T, LETTER_O, LETTER_O, BLANK, LETTER_F, LETTER_A, LETTER_S, LETTER_T },
+ .displayTime = uint16_t(UI_REFRESH_RATE_HZ * 1.0)
+};
+
+const MESSAGE OVERSPEED_WARNING_MESSAGE =
+{
+ .message = { LETTER_R, LETTER_P, LETTER_M, BLANK, LETTER_H, LETTER_I, LETTER_G, LETTER_H },
+ .displayTime = uint16_t(UI_REFRESH_RATE_HZ * .5)
+};
+
+#ifdef CROSS_AXIS
+const MESSAGE TAPER_ON_MESSAGE =
+{
+ .message = { LETTER_T, LETTER_A, LETTER_P, LETTER_E, LETTER_R, BLANK, LETTER_O, LETTER_N },
+ .displayTime = uint16_t(UI_REFRESH_RATE_HZ * 1.0)
+};
+
+const MESSAGE TAPER_OFF_MESSAGE =
+{
+ .message = { LETTER_N, LETTER_O, BLANK, LETTER_T, LETTER_A, LETTER_P, LETTER_E, LETTER_R },
+ .displayTime = uint16_t(UI_REFRESH_RATE_HZ * 1.0)
+};
+#endif
+
+const uint8_t START_DIGITS[10] = { ZERO, ONE, TWO, THREE, FOUR, FIVE, SIX, SEVEN, EIGHT, NINE };
 
 const uint16_t VALUE_BLANK[4] = { BLANK, BLANK, BLANK, BLANK };
 
@@ -88,6 +116,14 @@ UserInterface :: UserInterface(ControlPanel *controlPanel, Core *core, FeedTable
 
     this->feedTable = NULL;
 
+    this->starts = 1;
+    this->start = 0;
+    this->selectingStarts = false;
+
+#ifdef CROSS_AXIS
+    this->taper = false;
+#endif
+
     this->keys.all = 0xff;
 
     #ifdef USE_GEARBOX
@@ -185,6 +221,104 @@ void UserInterface :: panicStepBacklog( void )
     setMessage(&BACKLOG_PANIC_MESSAGE_1);
 }
 
+//
+// Step to the next or previous feed, unless the stepper could not keep up with
+// it at the current speed
+//
+void UserInterface :: changeFeed( bool up, uint16_t rpm )
+{
+    const FEED_THREAD *previous = feedTable->current();
+    const FEED_THREAD *feed = up ? feedTable->next() : feedTable->previous();
+
+    if( feed != previous && ! core->canSustain(feed, rpm) ) {
+        // the stepper could not keep up; stay on the old feed
+        if( up ) {
+            feedTable->previous();
+        } else {
+            feedTable->next();
+        }
+        setMessage(&FEED_REFUSED_MESSAGE);
+        return;
+    }
+
+    core->setFeed(feed);
+}
+
+//
+// Show the number of starts being chosen, or the start being cut
+//
+void UserInterface :: showStarts( void )
+{
+    if( this->selectingStarts ) {
+        const uint8_t message[8] = { START_DIGITS[this->starts], BLANK, LETTER_S, LETTER_T, LETTER_A, LETTER_R, LETTER_T, LETTER_S };
+        std::copy(message, message + 8, this->startMessage.message);
+    } else {
+        const uint8_t message[8] = { LETTER_S, LETTER_T, LETTER_A, LETTER_R, LETTER_T, START_DIGITS[this->start + 1], DASH, START_DIGITS[this->starts] };
+        std::copy(message, message + 8, this->startMessage.message);
+    }
+    this->startMessage.displayTime = uint16_t(UI_REFRESH_RATE_HZ * 1.5);
+    this->startMessage.next = NULL;
+    setMessage(&this->startMessage);
+}
+
+void UserInterface :: changeStarts( bool up )
+{
+    uint16_t starts = this->starts;
+    do {
+        starts += up ? 1 : -1;
+    } while( starts >= 1 && starts <= MAX_THREAD_STARTS && ! Core::isValidStarts(starts) );
+
+    if( starts >= 1 && starts <= MAX_THREAD_STARTS ) {
+        this->starts = starts;
+    }
+    showStarts();
+}
+
+//
+// SET while threading at rest: pick the number of starts, then move to the
+// next start after each pass; past the last start, choose again
+//
+void UserInterface :: advanceStart( void )
+{
+    if( this->selectingStarts ) {
+        this->selectingStarts = false;
+        this->start = 0;
+    }
+    else if( this->start + 1 < this->starts ) {
+        this->start++;
+    }
+    else {
+        this->selectingStarts = true;
+        showStarts();
+        return;
+    }
+
+    core->setThreadStart(this->starts, this->start);
+    showStarts();
+}
+
+void UserInterface :: resetStarts( void )
+{
+    this->starts = 1;
+    this->start = 0;
+    this->selectingStarts = false;
+    core->setThreadStart(1, 0);
+}
+
+#ifdef CROSS_AXIS
+//
+// Tapers are turned at a feed; leaving feed mode switches taper mode off
+//
+void UserInterface :: setTaper( bool taper )
+{
+    if( taper != this->taper ) {
+        this->taper = taper;
+        core->setTaper(taper ? TAPER_ANGLE_ARCMIN : 0);
+        setMessage(taper ? &TAPER_ON_MESSAGE : &TAPER_OFF_MESSAGE);
+    }
+}
+#endif
+
 void UserInterface :: loop( void )
 {
     // read the RPM up front so we can use it to make decisions
@@ -227,6 +361,10 @@ void UserInterface :: loop( void )
                 {
                     this->thread = ! this->thread;
                     core->setFeed(loadFeedTable());
+                    resetStarts();
+#ifdef CROSS_AXIS
+                    setTaper(false);
+#endif
                 }
 
                 if( keys.bit.FWD_REV )
@@ -238,7 +376,15 @@ void UserInterface :: loop( void )
 
             if( keys.bit.SET )
             {
-                setMessage(&SETTINGS_MESSAGE_1);
+                if( this->thread ) {
+                    advanceStart();
+                } else {
+#ifdef CROSS_AXIS
+                    setTaper(!this->taper);
+#else
+                    setMessage(&SETTINGS_MESSAGE_1);
+#endif
+                }
             }
         }
     }
@@ -250,6 +396,14 @@ void UserInterface :: loop( void )
             {
                 this->thread = gearboxState.feed_thread;
                 core->setFeed(loadFeedTable());
+                resetStarts();
+#ifdef CROSS_AXIS
+                setTaper(false);
+#endif
+                // the gearbox cannot be refused; at least say so at once
+                if( ! core->canSustain(feedTable->current(), currentRpm) ) {
+                    setMessage(&OVERSPEED_WARNING_MESSAGE);
+                }
             }
             
             if(rv && gearboxState.direction != lastGearboxState.direction)
@@ -264,6 +418,9 @@ void UserInterface :: loop( void )
                 if(gearboxState.gear != lastGearboxState.gear) {
                     this->setMessage(&GEAR_MESSAGE[(int)gearboxState.gear]);
                 }        
+                if( ! core->canSustain(feedTable->current(), currentRpm) ) {
+                    setMessage(&OVERSPEED_WARNING_MESSAGE);
+                }
             }
         }
     #endif
@@ -276,13 +433,25 @@ void UserInterface :: loop( void )
         // these should only work when the power is on
         if( this->core->getIsPowerOn() ) {
             // these keys can be operated when the machine is running
-            if( keys.bit.UP )
-            {
-                core->setFeed(feedTable->next());
+            if( this->selectingStarts ) {
+                if( keys.bit.UP )
+                {
+                    changeStarts(true);
+                }
+                if( keys.bit.DOWN )
+                {
+                    changeStarts(false);
+                }
             }
-            if( keys.bit.DOWN )
-            {
-                core->setFeed(feedTable->previous());
+            else {
+                if( keys.bit.UP )
+                {
+                    changeFeed(true, currentRpm);
+                }
+                if( keys.bit.DOWN )
+                {
+                    changeFeed(false, currentRpm);
+                }
             }
         }
 
@@ -290,6 +459,17 @@ void UserInterface :: loop( void )
     }
 #endif // IGNORE_ALL_KEYS_WHEN_RUNNING
 
+    // keep the number of starts up while it is being chosen
+    if( this->selectingStarts && this->message == NULL ) {
+        showStarts();
+    }
+
+    // warn before the stepper falls behind, rather than after it trips
+    if( core->getIsPowerOn() && currentRpm > 0 && this->message == NULL
+        && core->getHeadroom() < OVERSPEED_WARNING_HEADROOM ) {
+        setMessage(&OVERSPEED_WARNING_MESSAGE);
+    }
+
     // update the control panel
     controlPanel->setLEDs(calculateLEDs());
     controlPanel->setValue(feedTable->current()->display);
@@ -60,11 +60,33 @@ private:
     const MESSAGE *message;
     uint16_t messageTime;
 
+    //
+    // Multi-start threading: number of starts, the start being cut, and
+    // whether UP/DOWN are choosing the number of starts instead of the feed
+    //
+    uint16_t starts;
+    uint16_t start;
+    bool selectingStarts;
+    MESSAGE startMessage;
+
+#ifdef CROSS_AXIS
+    //
+    // Taper mode: the cross slide follows the carriage at TAPER_ANGLE_ARCMIN
+    //
+    bool taper;
+    void setTaper( bool taper );
+#endif
+
     const FEED_THREAD *loadFeedTable();
     LED_REG calculateLEDs();
     void setMessage(const MESSAGE *message);
     void overrideMessage( void );
     void clearMessage( void );
+    void changeFeed( bool up, uint16_t rpm );
+    void changeStarts( bool up );
+    void advanceStart( void );
+    void resetStarts( void );
+    void showStarts( void );
 
 public:
     UserInterface(ControlPanel *controlPanel, Core *core, FeedTableFactory *feedTableFactory, Gearbox *gearbox);
@@ -35,6 +35,7 @@
 #include "pico/stdlib.h"
 #include "pico/util/queue.h"
 #include "hardware/pio.h"
+#include "hardware/clocks.h"
 
 #include "ControlPanel.h"
 #include "StepperDrive.h"
@@ -43,6 +44,7 @@
 #include "UserInterface.h"
 #include "Gearbox.h"
 #include "SanityCheck.h"
+#include "RatioEngine.h"
 
 #ifdef USE_MULTICORE
 #include "CoreProxy.h"
@@ -68,6 +70,17 @@ bool core_motion_timer_callback( repeating_timer*);
 repeating_timer core_motion_timer;
 #endif
 
+#ifdef MOTION_EVENT_DRIVEN
+// Encoder events drive the motion loop; the timer is only a fallback
+#define MOTION_TIMER_US MOTION_FALLBACK_US
+
+void motion_event_isr(void);
+void start_motion_events(void);
+uint32_t motion_time;
+#else
+#define MOTION_TIMER_US STEPPER_CYCLE_US
+#endif
+
 void blink_pin_forever(PIO pio, uint sm, uint offset, uint pin, uint freq) {
     blink_program_init(pio, sm, offset, pin);
     pio_sm_set_enabled(pio, sm, true);
@@ -77,6 +90,49 @@ void blink_pin_forever(PIO pio, uint sm, uint offset, uint pin, uint freq) {
     pio->txf[sm] = (125000000 / (2 * freq)) - 3;
 }
 
+#ifdef BENCHMARK_FEED_RATIO
+//
+// Compare the cost of one feed calculation in the legacy floating-point path
+// (float ratio, double multiply - software emulated on the RP2350) against
+// the integer ratio engine, for a 20 TPI thread on an 8 TPI leadscrew
+//
+void benchmark_feed_ratio(void)
+{
+    const int32_t iterations = 100000;
+    const uint64_t numerator = uint64_t(8*STEPPER_RESOLUTION*STEPPER_MICROSTEPS*10);
+    const uint64_t denominator = uint64_t(200*ENCODER_RESOLUTION);
+    const float feed = (float)numerator / (float)denominator;
+    const float driveRatio = 1.5625;
+    volatile int32_t source = 0;
+    volatile int32_t sink;
+
+    uint32_t start = time_us_32();
+    for( int32_t i = 0; i < iterations; i++ ) {
+        int32_t count = source + i;
+        sink = (int32_t)((double)count * feed * driveRatio) * 1;
+    }
+    uint32_t legacyUs = time_us_32() - start;
+
+    uint32_t driveNumerator, driveDenominator;
+    RatioEngine::fromFloat(driveRatio, &driveNumerator, &driveDenominator);
+    RATIO ratio = RatioEngine::makeRatio(numerator * driveNumerator, denominator * driveDenominator, 1);
+    RatioEngine engine;
+    engine.setRatio(&ratio);
+
+    start = time_us_32();
+    for( int32_t i = 0; i < iterations; i++ ) {
+        int32_t count = source + i;
+        sink = engine.update(count);
+    }
+    uint32_t engineUs = time_us_32() - start;
+
+    uint32_t cyclesPerUs = clock_get_hz(clk_sys) / 1000000;
+    printf("Feed ratio, cycles per call: legacy %lu, ratio engine %lu\n",
+        (unsigned long)((uint64_t)legacyUs * cyclesPerUs / iterations),
+        (unsigned long)((uint64_t)engineUs * cyclesPerUs / iterations));
+}
+#endif
+
 //
 // DEPENDENCY INJECTION
 //
@@ -97,6 +153,9 @@ Encoder* encoder;
 
 // Stepper driver
 StepperDrive* stepperDrive;
+#ifdef CROSS_AXIS
+StepperDrive* crossDrive;
+#endif
 
 // Gearbox
 Gearbox* gearbox;
@@ -114,6 +173,24 @@ Core* core;
 // User Interface
 UserInterface* userInterface;
 
+//
+// One pass of the motion loop, told how many motion ticks have gone by
+//
+static inline void run_motion(void)
+{
+#ifdef MOTION_EVENT_DRIVEN
+    uint32_t ticks = (time_us_32() - motion_time) / STEPPER_CYCLE_US;
+    if( ticks == 0 ) {
+        // less than a tick since the last pass; the next event picks this up
+        return;
+    }
+    motion_time += ticks * STEPPER_CYCLE_US;
+    core->ISR(ticks);
+#else
+    core->ISR(1);
+#endif
+}
+
 int main()
 {
     stdio_init_all();
@@ -141,6 +218,9 @@ int main()
     controlPanel = new ControlPanel(spiBus);
     encoder = new Encoder();
     stepperDrive = new StepperDrive();
+    #ifdef CROSS_AXIS
+    crossDrive = new StepperDrive(CROSS_STEP_PIN, CROSS_DIRECTION_PIN, CROSS_ENABLE_PIN, CROSS_ALARM_PIN);
+    #endif
     gearbox = new Gearbox();
 
     #ifdef USE_MULTICORE
@@ -154,6 +234,10 @@ int main()
 
     // Initialize peripherals and pins
     stepperDrive->initHardware();  
+    #ifdef CROSS_AXIS
+    crossDrive->initHardware();
+    core->addAxis(crossDrive);
+    #endif
     encoder->initHardware();    
     spiBus->initHardware();  
     controlPanel->initHardware(); 
@@ -161,11 +245,18 @@ int main()
     #ifdef USE_MULTICORE
     multicore_launch_core1(core1_entry);  
     #else
-    add_repeating_timer_us(STEPPER_CYCLE_US, core_motion_timer_callback, NULL, &core_motion_timer);
+    #ifdef MOTION_EVENT_DRIVEN
+    start_motion_events();
+    #endif
+    add_repeating_timer_us(MOTION_TIMER_US, core_motion_timer_callback, NULL, &core_motion_timer);
     #endif
 
     printf("Initialized...\n");
 
+    #ifdef BENCHMARK_FEED_RATIO
+    benchmark_feed_ratio();
+    #endif
+
     while (true) {
         // check for step backlog and panic the system if it occurs
         if( coreProxy->getIsPanic() ) {
@@ -186,7 +277,10 @@ void core1_entry(void)
     // Create alarm pool for Core 1 (default alarm pool always interrupts Core 0)
     alarm_pool_t* core1_alarm_pool = alarm_pool_create_with_unused_hardware_alarm(16);
     alarm_pool_add_repeating_timer_us(core1_alarm_pool, 1000, core1_status_timer_callback, NULL, &core1_status_timer);
-    alarm_pool_add_repeating_timer_us(core1_alarm_pool, STEPPER_CYCLE_US, core1_core_motion_timer_callback, NULL, &core1_core_motion_timer);  
+    #ifdef MOTION_EVENT_DRIVEN
+    start_motion_events();
+    #endif
+    alarm_pool_add_repeating_timer_us(core1_alarm_pool, MOTION_TIMER_US, core1_core_motion_timer_callback, NULL, &core1_core_motion_timer);  
 
     // Unmask doorbell IRQ in Core 1
     irq_set_enabled(xCore->getDoorbellIrqNum(), true);  
@@ -204,7 +298,7 @@ bool core1_status_timer_callback( repeating_timer *rt )
 
 bool core1_core_motion_timer_callback( repeating_timer *rt )
 {
-    core->ISR();
+    run_motion();
     return true;
 }
 
@@ -225,7 +319,24 @@ void doorbell_core1_isr(void) {
 #else
 bool core_motion_timer_callback( repeating_timer *rt )
 {
-    core->ISR();
+    run_motion();
     return true;
 }
 #endif
+
+#ifdef MOTION_EVENT_DRIVEN
+// Route the encoder trigger IRQ to the calling core, at the same priority as
+// the timer so the two never preempt each other
+void start_motion_events(void)
+{
+    motion_time = time_us_32();
+    irq_set_exclusive_handler(encoder->getTriggerIrqNum(), motion_event_isr);
+    irq_set_enabled(encoder->getTriggerIrqNum(), true);
+}
+
+void motion_event_isr(void)
+{
+    encoder->clearTrigger();
+    run_motion();
+}
+#endif